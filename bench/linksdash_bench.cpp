@@ -0,0 +1,642 @@
+// Synthetic end-to-end benchmark for the linksdash_core data paths behind
+// the main window and tray menu. Prints one JSON document with a result per
+// operation and dataset size so runs can be compared across releases.
+
+#include "../data/async_database.h"
+#include "../data/database_service.h"
+#include "../data/link_groups.h"
+#include "../data/link_health_checker.h"
+#include "../data/link_repository.h"
+#include "../data/link_table_query.h"
+#include "../data/tray_snapshot.h"
+#include "../models/links_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPair>
+#include <QSqlQuery>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+
+namespace {
+constexpr int kCategoryCount = 250;
+// Zipf exponent for category sizes: a handful of big folders and a long tail.
+constexpr double kCategorySkew = 1.1;
+constexpr int kInsertChunkSize = 50000;
+constexpr int kSingleInsertCount = 200;
+constexpr int kSubmitInsertCount = 1000;
+constexpr int kSubmitUpdateCount = 100;
+constexpr int kConcurrentCommitRows = 20000;
+constexpr int kReadPageSize = 512;
+constexpr int kHealthCheckCount = 5000;
+constexpr int kEventLoopProbeMs = 10;
+constexpr int kVisitCount = 10000;
+constexpr quint32 kSeed = 20240601;
+
+const char *kWords[] = {
+    "alpha", "api", "archive", "blog", "board", "build", "cache", "chart", "cloud", "code",
+    "config", "daily", "data", "debug", "design", "docs", "draft", "editor", "engine", "feed",
+    "forum", "guide", "home", "index", "issue", "journal", "kernel", "lab", "library", "list",
+    "log", "manual", "map", "media", "metrics", "monitor", "news", "notes", "online", "paper",
+    "planner", "portal", "project", "queue", "recipe", "release", "report", "review", "roadmap", "search",
+    "server", "shop", "status", "store", "studio", "support", "task", "team", "tools", "tracker",
+    "travel", "video", "wiki", "work",
+};
+constexpr int kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+class LinkGenerator {
+public:
+    LinkGenerator()
+        : random_(kSeed)
+    {
+        std::vector<double> weights;
+        weights.reserve(kCategoryCount);
+        for (int k = 0; k < kCategoryCount; ++k) {
+            weights.push_back(1.0 / std::pow(k + 1, kCategorySkew));
+        }
+        categories_ = std::discrete_distribution<int>(weights.begin(), weights.end());
+    }
+
+    LinkItem next()
+    {
+        const int serial = serial_++;
+        const int wordCount = 2 + static_cast<int>(random_() % 4);
+        QString title;
+        for (int i = 0; i < wordCount; ++i) {
+            QString word = QString::fromLatin1(kWords[random_() % kWordCount]);
+            if (i == 0) {
+                word[0] = word.at(0).toUpper();
+            } else {
+                title += ' ';
+            }
+            title += word;
+        }
+        title += " " + QString::number(serial);
+
+        const int category = categories_(random_);
+        const QString host = QString::fromLatin1(kWords[random_() % kWordCount]);
+        const QString path = QString::fromLatin1(kWords[random_() % kWordCount]);
+        return {title,
+                QString("Category %1").arg(category, 3, 10, QChar('0')),
+                QString("https://www.%1%2.example.com/%3/%4").arg(host).arg(category).arg(path).arg(serial)};
+    }
+
+private:
+    std::mt19937 random_;
+    std::discrete_distribution<int> categories_;
+    int serial_ = 0;
+};
+
+template <typename T>
+T await(QFuture<T> future)
+{
+    future.waitForFinished();
+    return future.result();
+}
+
+template <typename Predicate>
+void waitUntil(Predicate done)
+{
+    while (!done()) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents);
+    }
+}
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1.0e6;
+}
+
+class Report {
+public:
+    void setProfile(const QString &profile)
+    {
+        profile_ = profile;
+    }
+
+    void add(int rows, const QString &operation, double milliseconds, qint64 items, QJsonObject extra = {})
+    {
+        extra["profile"] = profile_;
+        extra["rows"] = rows;
+        extra["operation"] = operation;
+        extra["ms"] = milliseconds;
+        extra["items"] = items;
+        if (milliseconds > 0 && items > 0) {
+            extra["per_second"] = items * 1000.0 / milliseconds;
+        }
+        results_.append(extra);
+        QTextStream(stderr) << QString("%1 %2 rows  %3 %4 ms\n")
+                                   .arg(profile_, -8)
+                                   .arg(rows, 8)
+                                   .arg(operation, -24)
+                                   .arg(milliseconds, 0, 'f', 2);
+    }
+
+    void addLatencies(int rows, const QString &operation, QVector<double> samples)
+    {
+        if (samples.isEmpty()) {
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        double total = 0;
+        for (const auto sample : samples) {
+            total += sample;
+        }
+        const auto percentile = [&samples](double p) {
+            const int index = static_cast<int>(std::ceil(p * samples.size())) - 1;
+            return samples.at(std::clamp(index, 0, static_cast<int>(samples.size()) - 1));
+        };
+
+        QJsonObject latency;
+        latency["mean_ms"] = total / samples.size();
+        latency["p50_ms"] = percentile(0.50);
+        latency["p95_ms"] = percentile(0.95);
+        latency["max_ms"] = samples.last();
+        add(rows, operation, total, samples.size(), latency);
+    }
+
+    QJsonDocument document() const
+    {
+        QJsonObject root;
+        root["benchmark"] = "linksdash_bench";
+        root["qt_version"] = qVersion();
+        root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        root["results"] = results_;
+        return QJsonDocument(root);
+    }
+
+private:
+    QJsonArray results_;
+    QString profile_;
+};
+
+// Keep-alive HTTP/1.1 stand-in for real sites: paths ending in "/dead" get
+// 404, everything else 200, both without a body.
+class LocalHttpServer {
+public:
+    bool listen()
+    {
+        QObject::connect(&server_, &QTcpServer::newConnection, &server_, [this]() {
+            while (auto *socket = server_.nextPendingConnection()) {
+                QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket]() { respond(socket); });
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+        return server_.listen(QHostAddress::LocalHost);
+    }
+
+    quint16 port() const
+    {
+        return server_.serverPort();
+    }
+
+private:
+    static void respond(QTcpSocket *socket)
+    {
+        auto buffer = socket->property("pending").toByteArray() + socket->readAll();
+        int end = -1;
+        while ((end = buffer.indexOf("\r\n\r\n")) >= 0) {
+            const auto requestLine = buffer.left(buffer.indexOf("\r\n"));
+            buffer.remove(0, end + 4);
+            const bool dead = requestLine.split(' ').value(1).endsWith("/dead");
+            socket->write(dead ? "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n"
+                               : "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+        }
+        socket->setProperty("pending", buffer);
+    }
+
+    QTcpServer server_;
+};
+
+bool check(bool ok, const QString &what, const QString &errorMessage)
+{
+    if (!ok) {
+        QTextStream(stderr) << what << " failed: " << errorMessage << "\n";
+    }
+    return ok;
+}
+
+// Page reads on a second connection while the worker commits a large batch.
+// Under a rollback journal these wait for the writer's lock; under WAL they
+// should not.
+bool measureReadsDuringCommit(int rows, AsyncDatabase *database, LinkGenerator *generator, Report *report)
+{
+    QString errorMessage;
+    if (!check(DatabaseManager::initialize(&errorMessage), "reader connection", errorMessage)) {
+        return false;
+    }
+
+    LinkBatch batch;
+    batch.inserted.reserve(kConcurrentCommitRows);
+    for (int i = 0; i < kConcurrentCommitRows; ++i) {
+        batch.inserted.append(generator->next());
+    }
+
+    QVector<double> latencies;
+    int failures = 0;
+    {
+        QSqlQuery query(DatabaseManager::database());
+        query.setForwardOnly(true);
+        query.prepare("SELECT id, title, category, url FROM links_view WHERE id > ? ORDER BY id LIMIT ?;");
+
+        QElapsedTimer timer;
+        qint64 afterId = 0;
+        auto commit = database->commit(batch);
+        while (!commit.isFinished()) {
+            timer.start();
+            query.bindValue(0, afterId);
+            query.bindValue(1, kReadPageSize);
+            if (query.exec()) {
+                while (query.next()) {
+                }
+            } else {
+                ++failures;
+            }
+            latencies.append(elapsedMs(timer));
+            afterId = (afterId + kReadPageSize * 37) % std::max(1, rows);
+        }
+        const auto result = await(commit);
+        if (!check(result.ok, "concurrent commit", result.errorMessage)) {
+            return false;
+        }
+    }
+    DatabaseManager::close();
+
+    if (failures > 0) {
+        QTextStream(stderr) << failures << " reads failed during the commit\n";
+    }
+    report->addLatencies(rows, "read_during_commit", latencies);
+    return true;
+}
+
+// Checks links against LocalHttpServer on the main thread's event loop and
+// records the longest delay of a 10 ms timer meanwhile, as a stand-in for
+// how long the GUI would have been unresponsive.
+bool measureHealthCheck(int rows, AsyncDatabase *database, Report *report)
+{
+    LocalHttpServer server;
+    if (!check(server.listen(), "local HTTP server", "cannot listen on localhost")) {
+        return false;
+    }
+
+    const int count = std::min(rows, kHealthCheckCount);
+    QList<LinkRecord> targets;
+    targets.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        LinkRecord target;
+        target.id = i + 1;
+        target.link.url = QString("http://127.0.0.1:%1/link/%2%3").arg(server.port()).arg(i).arg(i % 10 ? "" : "/dead");
+        targets.append(target);
+    }
+
+    LinkHealthChecker checker;
+    // Every target shares one host here.
+    checker.setMaxPerHost(LinkHealthChecker::kDefaultMaxConcurrent);
+    QList<LinkHealth> results;
+    bool finished = false;
+    QObject::connect(&checker, &LinkHealthChecker::checked, &checker, [&results](const QList<LinkHealth> &batch) {
+        results += batch;
+    });
+    QObject::connect(&checker, &LinkHealthChecker::finished, &checker, [&finished]() { finished = true; });
+
+    QElapsedTimer lagTimer;
+    double maxLagMs = 0;
+    QTimer probe;
+    probe.setInterval(kEventLoopProbeMs);
+    QObject::connect(&probe, &QTimer::timeout, &probe, [&]() {
+        maxLagMs = std::max(maxLagMs, elapsedMs(lagTimer) - kEventLoopProbeMs);
+        lagTimer.start();
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    lagTimer.start();
+    probe.start();
+    checker.start(targets);
+    waitUntil([&finished]() { return finished; });
+    probe.stop();
+
+    const auto dead = std::count_if(results.cbegin(), results.cend(), [](const LinkHealth &health) {
+        return health.isDead();
+    });
+    QJsonObject extra;
+    extra["dead"] = static_cast<qint64>(dead);
+    extra["max_event_loop_lag_ms"] = maxLagMs;
+    report->add(rows, "health_check", elapsedMs(timer), results.size(), extra);
+    if (!check(results.size() == count, "health check", "not every link was checked")) {
+        return false;
+    }
+
+    timer.start();
+    const auto saved = await(database->saveHealth(results));
+    report->add(rows, "health_save", elapsedMs(timer), results.size());
+    return check(saved.ok, "health save", saved.errorMessage);
+}
+
+bool runDataset(int rows, const QString &directory, const QString &profile, Report *report)
+{
+    DatabaseManager::setDatabaseFilePath(
+        QDir(directory).filePath(QString("bench-%1-%2.sqlite").arg(profile).arg(rows)));
+    LinkGenerator generator;
+    QElapsedTimer timer;
+
+    auto database = std::make_unique<AsyncDatabase>();
+    timer.start();
+    auto opened = await(database->open());
+    report->add(rows, "initialize_empty", elapsedMs(timer), 1);
+    if (!check(opened.ok, "initialize", opened.errorMessage)) {
+        return false;
+    }
+
+    // Bulk insert in transaction-sized chunks; generating rows is not timed.
+    double insertMs = 0;
+    for (int done = 0; done < rows; done += kInsertChunkSize) {
+        LinkBatch batch;
+        const int count = std::min(kInsertChunkSize, rows - done);
+        batch.inserted.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            batch.inserted.append(generator.next());
+        }
+        timer.start();
+        const auto result = await(database->commit(batch));
+        insertMs += elapsedMs(timer);
+        if (!check(result.ok, "bulk insert", result.errorMessage)) {
+            return false;
+        }
+    }
+    report->add(rows, "bulk_insert", insertMs, rows);
+
+    // Reopen so initialize runs against a populated file, as on a normal start.
+    database = std::make_unique<AsyncDatabase>();
+    timer.start();
+    opened = await(database->open());
+    report->add(rows, "initialize", elapsedMs(timer), 1);
+    if (!check(opened.ok, "initialize", opened.errorMessage)) {
+        return false;
+    }
+
+    {
+        LinksModel model(database.get());
+        timer.start();
+        model.select();
+        waitUntil([&model]() { return !model.isFetching(); });
+        report->add(rows, "select_first_page", elapsedMs(timer), model.rowCount());
+        while (model.canFetchMore(QModelIndex())) {
+            model.fetchMore(QModelIndex());
+            waitUntil([&model]() { return !model.isFetching(); });
+        }
+        report->add(rows, "select_all", elapsedMs(timer), model.rowCount());
+
+        // The table's filter and sort, as LinkTableProxy runs them on its worker.
+        const auto columns = model.columns();
+        const auto notCancelled = []() { return false; };
+        LinkTableQuery filterQuery;
+        filterQuery.filter = LinkTable::parseFilter("data category:\"Category 001\" host:example.com");
+        QVector<int> filtered;
+        timer.start();
+        LinkTable::evaluate(columns, filterQuery, notCancelled, &filtered);
+        report->add(rows, "table_filter", elapsedMs(timer), filtered.size());
+
+        LinkTableQuery sortQuery;
+        sortQuery.sortKeys = {{LinkColumns::CategoryColumn, Qt::AscendingOrder},
+                              {LinkColumns::TitleColumn, Qt::DescendingOrder}};
+        QVector<int> sorted;
+        timer.start();
+        LinkTable::evaluate(columns, sortQuery, notCancelled, &sorted);
+        report->add(rows, "table_sort", elapsedMs(timer), sorted.size());
+
+        timer.start();
+        const auto loaded = await(database->loadAll());
+        report->add(rows, "load_all", elapsedMs(timer), loaded.records.size());
+        if (!check(loaded.ok, "load all", loaded.errorMessage)) {
+            return false;
+        }
+
+        LinkGroups groups;
+        timer.start();
+        groups.reset(loaded.records);
+        report->add(rows, "group_sort", elapsedMs(timer), groups.linkCount());
+
+        const auto snapshotPath = TraySnapshot::pathFor(DatabaseManager::databaseFilePath());
+        QString snapshotError;
+        timer.start();
+        const bool snapshotWritten = TraySnapshot::write(snapshotPath, groups, QByteArray(), &snapshotError);
+        report->add(rows, "snapshot_write", elapsedMs(timer), groups.linkCount());
+        if (!check(snapshotWritten, "snapshot write", snapshotError)) {
+            return false;
+        }
+
+        {
+            TraySnapshot snapshot;
+            timer.start();
+            const bool opened = snapshot.open(snapshotPath, &snapshotError);
+            report->add(rows, "snapshot_open", elapsedMs(timer), snapshot.groupCount());
+            if (!check(opened, "snapshot open", snapshotError)) {
+                return false;
+            }
+
+            LinkGroups restored;
+            timer.start();
+            restored.restore(snapshot);
+            report->add(rows, "snapshot_restore", elapsedMs(timer), restored.linkCount());
+        }
+
+        QVector<double> latencies;
+        latencies.reserve(kSingleInsertCount);
+        for (int i = 0; i < kSingleInsertCount; ++i) {
+            const auto link = generator.next();
+            timer.start();
+            const auto result = await(database->insert(link));
+            latencies.append(elapsedMs(timer));
+            if (!check(result.ok, "single insert", result.errorMessage)) {
+                return false;
+            }
+        }
+        report->addLatencies(rows, "single_insert", latencies);
+
+        latencies.clear();
+        const int loadedCount = static_cast<int>(loaded.records.size());
+        const int lookups = std::min(kSingleInsertCount, loadedCount);
+        for (int i = 0; i < lookups; ++i) {
+            const auto &url = loaded.records.at(i * (loadedCount / std::max(1, lookups))).link.url;
+            timer.start();
+            const auto result = await(database->findByUrl(url));
+            latencies.append(elapsedMs(timer));
+            if (!check(result.ok, "find by url", result.errorMessage)) {
+                return false;
+            }
+        }
+        report->addLatencies(rows, "find_by_url", latencies);
+
+        {
+            QString duplicatesError;
+            QList<QList<LinkRecord>> duplicates;
+            timer.start();
+            auto *links = DatabaseManager::repository(&duplicatesError);
+            const bool scanned = links && links->duplicates(&duplicates, &duplicatesError);
+            report->add(rows, "find_duplicates", elapsedMs(timer), duplicates.size());
+            DatabaseManager::close();
+            if (!check(scanned, "find duplicates", duplicatesError)) {
+                return false;
+            }
+        }
+
+        if (!measureHealthCheck(rows, database.get(), report)) {
+            return false;
+        }
+
+        // Skewed towards the first rows, like real usage.
+        UsageLog usage(kVisitCount);
+        const qint64 now = QDateTime::currentSecsSinceEpoch();
+        for (int i = 0; i < kVisitCount; ++i) {
+            const int row = static_cast<int>(loadedCount * std::pow((i % 97) / 97.0, 3));
+            usage.record(loaded.records.at(std::min(row, loadedCount - 1)).id, now - (kVisitCount - i));
+        }
+        timer.start();
+        const auto visited = await(database->recordVisits(usage.drain()));
+        report->add(rows, "record_visits", elapsedMs(timer), kVisitCount);
+        if (!check(visited.ok, "record visits", visited.errorMessage)) {
+            return false;
+        }
+
+        FrecencyRanking ranking;
+        timer.start();
+        for (const auto &entry : visited.entries) {
+            ranking.update(entry);
+        }
+        report->add(rows, "frecency_update", elapsedMs(timer), visited.entries.size());
+
+        if (!measureReadsDuringCommit(rows, database.get(), &generator, report)) {
+            return false;
+        }
+
+        const int updates = std::min(kSubmitUpdateCount, model.rowCount());
+        const int stride = std::max(1, model.rowCount() / std::max(1, updates));
+        for (int i = 0; i < updates; ++i) {
+            auto link = model.link(i * stride);
+            link.title += " (edited)";
+            model.updateLink(i * stride, link);
+        }
+        for (int i = 0; i < kSubmitInsertCount; ++i) {
+            model.appendLink(generator.next());
+        }
+
+        bool finished = false;
+        bool saved = false;
+        QString saveError;
+        LinkChangeSet saveChanges;
+        QObject::connect(&model, &LinksModel::linksChanged, &model, [&saveChanges](const LinkChangeSet &changes) {
+            saveChanges = changes;
+        });
+        QObject::connect(&model, &LinksModel::submitFinished, &model, [&](bool ok, const QString &errorMessage) {
+            finished = true;
+            saved = ok;
+            saveError = errorMessage;
+        });
+        timer.start();
+        model.submitAll();
+        waitUntil([&finished]() { return finished; });
+        report->add(rows, "submit_all", elapsedMs(timer), updates + kSubmitInsertCount);
+        if (!check(saved, "submitAll", saveError)) {
+            return false;
+        }
+        waitUntil([&model]() { return !model.isFetching(); });
+
+        timer.start();
+        groups.apply(saveChanges);
+        report->add(rows, "group_apply", elapsedMs(timer), saveChanges.size());
+    }
+
+    database.reset();
+    return true;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("linksdash_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times LinksDash data paths on synthetic link sets and prints JSON.");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma-separated dataset sizes.", "rows", "1000,10000,100000,1000000");
+    QCommandLineOption profilesOption("profiles",
+                                      "Comma-separated storage profiles to compare: sqlite (SQLite defaults) "
+                                      "and tuned (StorageProfile defaults).",
+                                      "names", "sqlite,tuned");
+    QCommandLineOption outputOption({"o", "output"}, "Write the JSON report to file instead of stdout.", "file");
+    parser.addOption(sizesOption);
+    parser.addOption(profilesOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    QList<QPair<QString, StorageProfile>> profiles;
+    for (const auto &part : parser.value(profilesOption).split(',', Qt::SkipEmptyParts)) {
+        const auto name = part.trimmed();
+        if (name == "sqlite") {
+            profiles.append({name, StorageProfile::sqliteDefaults()});
+        } else if (name == "tuned") {
+            profiles.append({name, StorageProfile()});
+        } else {
+            QTextStream(stderr) << "Unknown storage profile: " << name << "\n";
+            return 2;
+        }
+    }
+
+    QVector<int> sizes;
+    for (const auto &part : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const int rows = part.trimmed().toInt(&ok);
+        if (!ok || rows <= 0) {
+            QTextStream(stderr) << "Invalid dataset size: " << part << "\n";
+            return 2;
+        }
+        sizes.append(rows);
+    }
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        QTextStream(stderr) << "Failed to create a temporary directory.\n";
+        return 1;
+    }
+
+    Report report;
+    for (const auto &profile : profiles) {
+        DatabaseManager::setStorageProfile(profile.second);
+        report.setProfile(profile.first);
+        for (const auto rows : sizes) {
+            if (!runDataset(rows, directory.path(), profile.first, &report)) {
+                return 1;
+            }
+        }
+    }
+
+    const auto json = report.document().toJson(QJsonDocument::Indented);
+    if (!parser.isSet(outputOption)) {
+        QTextStream(stdout) << json;
+        return 0;
+    }
+
+    QFile output(parser.value(outputOption));
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate) || output.write(json) != json.size()) {
+        QTextStream(stderr) << "Failed to write " << output.fileName() << ": " << output.errorString() << "\n";
+        return 1;
+    }
+    return 0;
+}
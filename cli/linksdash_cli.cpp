@@ -0,0 +1,246 @@
+// Headless front end over linksdash_core for scripting and profiling. All
+// work runs synchronously on the main thread's own connection.
+
+#include "../data/database_service.h"
+#include "../data/link_exporter.h"
+#include "../data/link_groups.h"
+#include "../data/link_importer.h"
+#include "../data/link_repository.h"
+#include "../data/link_search.h"
+#include "../main.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QSettings>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTextStream>
+
+namespace {
+const char *kSelectAllSql = "SELECT id, title, category, url FROM links_view ORDER BY id;";
+constexpr int kDefaultSearchLimit = 20;
+
+QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+QTextStream &err()
+{
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+bool selectLinks(const QString &sql, const QVariantList &bindings, QList<LinkRecord> *records)
+{
+    QSqlQuery query(DatabaseManager::database());
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    for (int i = 0; i < bindings.size(); ++i) {
+        query.bindValue(i, bindings.at(i));
+    }
+    if (!query.exec()) {
+        err() << query.lastError().text() << Qt::endl;
+        return false;
+    }
+    while (query.next()) {
+        LinkRecord record;
+        record.id = query.value(0).toLongLong();
+        record.link.title = query.value(1).toString();
+        record.link.category = query.value(2).toString();
+        record.link.url = query.value(3).toString();
+        records->append(record);
+    }
+    return true;
+}
+
+void printRecords(const QList<LinkRecord> &records)
+{
+    for (const auto &record : records) {
+        out() << record.id << '\t' << record.link.title << '\t' << record.link.category << '\t'
+              << record.link.url << '\n';
+    }
+    out().flush();
+}
+
+int runList()
+{
+    QList<LinkRecord> records;
+    if (!selectLinks(kSelectAllSql, {}, &records)) {
+        return 1;
+    }
+    printRecords(records);
+    return 0;
+}
+
+int runGroups()
+{
+    QList<LinkRecord> records;
+    if (!selectLinks(kSelectAllSql, {}, &records)) {
+        return 1;
+    }
+    LinkGroups groups;
+    groups.reset(records);
+    for (auto it = groups.groups().cbegin(); it != groups.groups().cend(); ++it) {
+        out() << it->category << '\t' << it->entries.size() << '\n';
+    }
+    out().flush();
+    return 0;
+}
+
+int runSearch(const QString &text, int limit)
+{
+    const auto expression = LinkSearch::matchExpression(text);
+    if (expression.isEmpty()) {
+        return 0;
+    }
+    QList<LinkRecord> records;
+    if (!selectLinks(LinkSearch::kSearchSql, {expression, limit}, &records)) {
+        return 1;
+    }
+    printRecords(records);
+    return 0;
+}
+
+int runImport(const QString &path)
+{
+    auto db = DatabaseManager::database();
+    const auto result = LinkImporter::importFile(db, path);
+    if (!result.ok) {
+        err() << "Import failed: " << result.errorMessage << Qt::endl;
+        return 1;
+    }
+    out() << "Imported " << result.imported << " links, skipped " << result.skipped << " without a URL and "
+          << result.duplicates << " already saved" << Qt::endl;
+    return 0;
+}
+
+// Lists links that share a canonical URL. With merge, keeps the oldest link
+// of every set and deletes the others in one transaction.
+int runDedupe(bool merge)
+{
+    QString errorMessage;
+    auto *links = DatabaseManager::repository(&errorMessage);
+    QList<QList<LinkRecord>> groups;
+    if (!links || !links->duplicates(&groups, &errorMessage)) {
+        err() << errorMessage << Qt::endl;
+        return 1;
+    }
+
+    int redundant = 0;
+    for (const auto &group : groups) {
+        printRecords(group);
+        out() << Qt::endl;
+        redundant += group.size() - 1;
+    }
+    out() << groups.size() << " duplicated URLs, " << redundant << " redundant links" << Qt::endl;
+    if (!merge || redundant == 0) {
+        return 0;
+    }
+
+    auto db = links->database();
+    if (!db.transaction()) {
+        err() << db.lastError().text() << Qt::endl;
+        return 1;
+    }
+    for (const auto &group : groups) {
+        for (int i = 1; i < group.size(); ++i) {
+            if (!links->remove(group.at(i).id, &errorMessage)) {
+                db.rollback();
+                links->discardCaches();
+                err() << "Merge failed: " << errorMessage << Qt::endl;
+                return 1;
+            }
+        }
+    }
+    if (!links->pruneCategories(&errorMessage) || !db.commit()) {
+        if (errorMessage.isEmpty()) {
+            errorMessage = db.lastError().text();
+        }
+        db.rollback();
+        links->discardCaches();
+        err() << "Merge failed: " << errorMessage << Qt::endl;
+        return 1;
+    }
+    out() << "Removed " << redundant << " links" << Qt::endl;
+    return 0;
+}
+
+int runExport(const QString &path)
+{
+    auto db = DatabaseManager::database();
+    const auto result = LinkExporter::exportToFile(db, path, LinkExporter::formatForPath(path));
+    if (!result.ok) {
+        err() << "Export failed: " << result.errorMessage << Qt::endl;
+        return 1;
+    }
+    out() << "Exported " << result.exported << " links" << Qt::endl;
+    return 0;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Same names as the GUI so the default database path is shared.
+    QCoreApplication::setApplicationName(AppConfig::kName);
+    QCoreApplication::setOrganizationName(AppConfig::kOrganization);
+    QCoreApplication::setOrganizationDomain(AppConfig::kDomain);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Command line access to the LinksDash database.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "list, groups, search <text>, import <file>, export <file> or dedupe.");
+    QCommandLineOption databaseOption("database", "Use this database file instead of the default.", "file");
+    QCommandLineOption limitOption("limit", "Maximum number of search results.", "count",
+                                   QString::number(kDefaultSearchLimit));
+    parser.addOption(databaseOption);
+    QCommandLineOption mergeOption("merge", "With dedupe, delete all but the oldest link of each duplicate set.");
+    parser.addOption(limitOption);
+    parser.addOption(mergeOption);
+    parser.process(app);
+
+    const auto arguments = parser.positionalArguments();
+    if (arguments.isEmpty()) {
+        parser.showHelp(2);
+    }
+    const auto command = arguments.first();
+    const auto argument = arguments.mid(1).join(' ');
+    const bool needsArgument = command == "search" || command == "import" || command == "export";
+    if (needsArgument && argument.isEmpty()) {
+        err() << command << " needs an argument." << Qt::endl;
+        return 2;
+    }
+
+    DatabaseManager::setStorageProfile(StorageProfile::load(QSettings()));
+    if (parser.isSet(databaseOption)) {
+        DatabaseManager::setDatabaseFilePath(parser.value(databaseOption));
+    }
+    QString errorMessage;
+    auto *links = DatabaseManager::initialize(&errorMessage) ? DatabaseManager::repository(&errorMessage) : nullptr;
+    if (!links || !links->refreshUrlHashes(&errorMessage)) {
+        err() << errorMessage << Qt::endl;
+        return 1;
+    }
+
+    int status = 2;
+    if (command == "list") {
+        status = runList();
+    } else if (command == "groups") {
+        status = runGroups();
+    } else if (command == "search") {
+        status = runSearch(argument, qMax(1, parser.value(limitOption).toInt()));
+    } else if (command == "import") {
+        status = runImport(argument);
+    } else if (command == "export") {
+        status = runExport(argument);
+    } else if (command == "dedupe") {
+        status = runDedupe(parser.isSet(mergeOption));
+    } else {
+        err() << "Unknown command: " << command << Qt::endl;
+    }
+
+    DatabaseManager::close();
+    return status;
+}
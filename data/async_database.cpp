@@ -0,0 +1,514 @@
+#include "async_database.h"
+
+#include "../tracing.h"
+#include "database_service.h"
+#include "link_repository.h"
+#include "link_search.h"
+
+#include <QHash>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QtConcurrent>
+
+#include <functional>
+
+namespace {
+QSqlDatabase openDatabase(QString *errorMessage)
+{
+    auto db = DatabaseManager::database();
+    if (!db.isValid() || !db.isOpen()) {
+        *errorMessage = "Database is not open.";
+        return {};
+    }
+    return db;
+}
+
+LinkQueryResult runQuery(const QString &sql, const QVariantList &bindings)
+{
+    LinkQueryResult result;
+    const auto db = openDatabase(&result.errorMessage);
+    if (!db.isValid()) {
+        result.ok = false;
+        return result;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.prepare(sql)) {
+        result.ok = false;
+        result.errorMessage = query.lastError().text();
+        return result;
+    }
+    for (int i = 0; i < bindings.size(); ++i) {
+        query.bindValue(i, bindings.at(i));
+    }
+    if (!query.exec()) {
+        result.ok = false;
+        result.errorMessage = query.lastError().text();
+        return result;
+    }
+
+    const bool hasSortKey = query.record().count() > 4;
+    while (query.next()) {
+        LinkRecord record;
+        record.id = query.value(0).toLongLong();
+        record.link.title = query.value(1).toString();
+        record.link.category = query.value(2).toString();
+        record.link.url = query.value(3).toString();
+        if (hasSortKey) {
+            record.sortKey = query.value(4).toByteArray();
+        }
+        result.records.append(record);
+    }
+    return result;
+}
+
+LinkQueryResult runRepositoryQuery(
+    const std::function<bool(LinkRepository *, QList<LinkRecord> *, QString *)> &read)
+{
+    LinkQueryResult result;
+    auto *links = DatabaseManager::repository(&result.errorMessage);
+    result.ok = links && read(links, &result.records, &result.errorMessage);
+    return result;
+}
+
+LinkChangesResult readChanges(qint64 sequence)
+{
+    LinkChangesResult result;
+    auto *links = DatabaseManager::repository(&result.errorMessage);
+    if (!links) {
+        result.ok = false;
+        return result;
+    }
+    if (sequence < 0) {
+        result.ok = links->latestChangeSequence(&result.sequence, &result.errorMessage);
+        return result;
+    }
+    result.ok = links->changesSince(sequence, &result.changes, &result.sequence, &result.errorMessage);
+    return result;
+}
+
+bool writeBatch(LinkRepository *links, const LinkBatch &batch, LinkBatchResult *result)
+{
+    for (const auto id : batch.removed) {
+        if (!links->remove(id, &result->errorMessage)) {
+            return false;
+        }
+    }
+
+    for (const auto &record : batch.updated) {
+        if (!links->update(record, &result->errorMessage)) {
+            return false;
+        }
+    }
+
+    for (const auto &link : batch.inserted) {
+        qint64 id = -1;
+        if (!links->insert(link, &id, &result->errorMessage)) {
+            return false;
+        }
+        result->insertedIds.append(id);
+    }
+
+    if (!batch.removed.isEmpty() || !batch.updated.isEmpty()) {
+        return links->pruneCategories(&result->errorMessage);
+    }
+    return true;
+}
+
+LinkBatchResult runBatch(const LinkBatch &batch)
+{
+    const Tracing::Span span("AsyncDatabase::runBatch");
+    LinkBatchResult result;
+    auto *links = DatabaseManager::repository(&result.errorMessage);
+    if (!links) {
+        result.ok = false;
+        return result;
+    }
+
+    auto db = links->database();
+    if (!db.transaction()) {
+        result.ok = false;
+        result.errorMessage = db.lastError().text();
+        return result;
+    }
+
+    if (!writeBatch(links, batch, &result)) {
+        result.ok = false;
+        result.insertedIds.clear();
+        db.rollback();
+        links->discardCaches();
+        return result;
+    }
+
+    if (!db.commit()) {
+        result.ok = false;
+        result.errorMessage = db.lastError().text();
+        result.insertedIds.clear();
+        db.rollback();
+        links->discardCaches();
+        return result;
+    }
+
+    // A new URL with the same canonical form trips the stale-hash trigger.
+    // The batch is saved either way, and the next poll retries the refresh.
+    QString refreshError;
+    if (!links->refreshUrlHashes(&refreshError)) {
+        qWarning("Failed to refresh URL hashes: %s", qPrintable(refreshError));
+    }
+    return result;
+}
+
+DatabaseResult saveHealthResults(const QList<LinkHealth> &results)
+{
+    DatabaseResult result;
+    auto *links = DatabaseManager::repository(&result.errorMessage);
+    if (!links) {
+        result.ok = false;
+        return result;
+    }
+
+    auto db = links->database();
+    if (!db.transaction()) {
+        result.ok = false;
+        result.errorMessage = db.lastError().text();
+        return result;
+    }
+    if (!links->saveHealth(results, &result.errorMessage)) {
+        result.ok = false;
+        db.rollback();
+        return result;
+    }
+    if (!db.commit()) {
+        result.ok = false;
+        result.errorMessage = db.lastError().text();
+        db.rollback();
+    }
+    return result;
+}
+
+LinkFrecencyResult recordVisitBatch(const QList<LinkVisit> &visits)
+{
+    LinkFrecencyResult result;
+    auto *links = DatabaseManager::repository(&result.errorMessage);
+    if (!links) {
+        result.ok = false;
+        return result;
+    }
+
+    auto db = links->database();
+    if (!db.transaction()) {
+        result.ok = false;
+        result.errorMessage = db.lastError().text();
+        return result;
+    }
+    QHash<qint64, int> positions;
+    for (const auto &visit : visits) {
+        LinkFrecency entry;
+        if (!links->recordVisit(visit, &entry, &result.errorMessage)) {
+            if (result.errorMessage.isEmpty()) {
+                // The link was deleted since it was opened.
+                continue;
+            }
+            result.ok = false;
+            result.entries.clear();
+            db.rollback();
+            return result;
+        }
+        // Report each link once, with its final key.
+        const auto position = positions.constFind(entry.record.id);
+        if (position != positions.cend()) {
+            result.entries[*position] = entry;
+        } else {
+            positions.insert(entry.record.id, static_cast<int>(result.entries.size()));
+            result.entries.append(entry);
+        }
+    }
+    if (!db.commit()) {
+        result.ok = false;
+        result.errorMessage = db.lastError().text();
+        result.entries.clear();
+        db.rollback();
+    }
+    return result;
+}
+
+// Background jobs open a connection for the calling pool thread and close it
+// again when done, since pool threads outlive the job.
+ExportResult runExport(const QString &path, LinkExporter::Format format,
+                       const LinkExporter::ProgressCallback &progress)
+{
+    ExportResult result;
+    if (!DatabaseManager::initialize(&result.errorMessage)) {
+        result.ok = false;
+        return result;
+    }
+    {
+        auto db = DatabaseManager::database();
+        result = LinkExporter::exportToFile(db, path, format, progress);
+    }
+    DatabaseManager::close();
+    return result;
+}
+
+DatabaseResult runBackup(const QString &path)
+{
+    DatabaseResult result;
+    if (!DatabaseManager::initialize(&result.errorMessage)) {
+        result.ok = false;
+        return result;
+    }
+    {
+        auto db = DatabaseManager::database();
+        result.ok = LinkExporter::backup(db, path, &result.errorMessage);
+    }
+    DatabaseManager::close();
+    return result;
+}
+}
+
+AsyncDatabase::AsyncDatabase(QObject *parent)
+    : QObject(parent)
+{
+    // A single thread that never expires keeps the per-thread connection alive
+    // and runs requests in submission order.
+    pool_.setMaxThreadCount(1);
+    pool_.setExpiryTimeout(-1);
+    backgroundPool_.setMaxThreadCount(1);
+}
+
+AsyncDatabase::~AsyncDatabase()
+{
+    exportCancelled_ = true;
+    backgroundPool_.waitForDone();
+    // Queued behind any work still pending, so the connection closes last.
+    auto closed = QtConcurrent::run(&pool_, []() { DatabaseManager::close(); });
+    closed.waitForFinished();
+    pool_.waitForDone();
+}
+
+QFuture<DatabaseResult> AsyncDatabase::open()
+{
+    return QtConcurrent::run(&pool_, []() {
+        DatabaseResult result;
+        if (!DatabaseManager::initialize(&result.errorMessage)) {
+            result.ok = false;
+            return result;
+        }
+        // Rows other tools wrote since the last run need hashes before the
+        // first duplicate check.
+        auto *links = DatabaseManager::repository(&result.errorMessage);
+        result.ok = links && links->refreshUrlHashes(&result.errorMessage);
+        return result;
+    });
+}
+
+QFuture<DatabaseResult> AsyncDatabase::applyStorageProfile()
+{
+    return QtConcurrent::run(&pool_, []() {
+        DatabaseResult result;
+        result.ok = DatabaseManager::applyStorageProfile(&result.errorMessage);
+        return result;
+    });
+}
+
+QFuture<DatabaseResult> AsyncDatabase::runMaintenance()
+{
+    return QtConcurrent::run(&pool_, []() {
+        DatabaseResult result;
+        result.ok = DatabaseManager::runMaintenance(&result.errorMessage);
+        return result;
+    });
+}
+
+QFuture<LinkQueryResult> AsyncDatabase::loadAll()
+{
+    return QtConcurrent::run(&pool_, []() {
+        const Tracing::Span span("AsyncDatabase::loadAll");
+        return runRepositoryQuery([](LinkRepository *links, QList<LinkRecord> *records, QString *errorMessage) {
+            return links->listAll(records, errorMessage);
+        });
+    });
+}
+
+QFuture<LinkQueryResult> AsyncDatabase::loadPage(qint64 afterId, int limit)
+{
+    return QtConcurrent::run(&pool_, [afterId, limit]() {
+        const Tracing::Span span("AsyncDatabase::loadPage");
+        return runRepositoryQuery([afterId, limit](LinkRepository *links, QList<LinkRecord> *records,
+                                                   QString *errorMessage) {
+            return links->listPage(afterId, limit, records, errorMessage);
+        });
+    });
+}
+
+QFuture<LinkQueryResult> AsyncDatabase::query(const QString &sql, const QVariantList &bindings)
+{
+    return QtConcurrent::run(&pool_, [sql, bindings]() { return runQuery(sql, bindings); });
+}
+
+QFuture<LinkQueryResult> AsyncDatabase::search(const QString &text, int limit)
+{
+    const auto expression = LinkSearch::matchExpression(text);
+    return QtConcurrent::run(&pool_, [expression, limit]() {
+        const Tracing::Span span("AsyncDatabase::search");
+        if (expression.isEmpty()) {
+            return LinkQueryResult();
+        }
+        return runRepositoryQuery([expression, limit](LinkRepository *links, QList<LinkRecord> *records,
+                                                      QString *errorMessage) {
+            return links->search(expression, limit, records, errorMessage);
+        });
+    });
+}
+
+QFuture<LinkQueryResult> AsyncDatabase::findByUrl(const QString &url)
+{
+    return QtConcurrent::run(&pool_, [url]() {
+        return runRepositoryQuery([url](LinkRepository *links, QList<LinkRecord> *records, QString *errorMessage) {
+            return links->findByUrl(url, records, errorMessage);
+        });
+    });
+}
+
+QFuture<LinkChangesResult> AsyncDatabase::changesSince(qint64 sequence)
+{
+    return QtConcurrent::run(&pool_, [sequence]() { return readChanges(sequence); });
+}
+
+QFuture<LinkChangesResult> AsyncDatabase::pollChanges(qint64 sequence)
+{
+    return QtConcurrent::run(&pool_, [this, sequence]() {
+        LinkChangesResult result;
+        result.sequence = sequence;
+        auto *links = DatabaseManager::repository(&result.errorMessage);
+        qint64 version = 0;
+        if (!links || !links->dataVersion(&version, &result.errorMessage)) {
+            result.ok = false;
+            return result;
+        }
+        if (version == lastDataVersion_) {
+            return result;
+        }
+        lastDataVersion_ = version;
+        // Another connection committed and may have pruned or renumbered
+        // categories, so cached category ids can no longer be trusted.
+        links->discardCaches();
+        if (!links->refreshUrlHashes(&result.errorMessage)) {
+            result.ok = false;
+            return result;
+        }
+        return readChanges(sequence);
+    });
+}
+
+QFuture<LinkBatchResult> AsyncDatabase::insert(const LinkItem &link)
+{
+    LinkBatch batch;
+    batch.inserted.append(link);
+    return commit(batch);
+}
+
+QFuture<LinkBatchResult> AsyncDatabase::update(const LinkRecord &record)
+{
+    LinkBatch batch;
+    batch.updated.append(record);
+    return commit(batch);
+}
+
+QFuture<LinkBatchResult> AsyncDatabase::remove(qint64 id)
+{
+    LinkBatch batch;
+    batch.removed.append(id);
+    return commit(batch);
+}
+
+QFuture<LinkBatchResult> AsyncDatabase::commit(const LinkBatch &batch)
+{
+    return QtConcurrent::run(&pool_, [batch]() { return runBatch(batch); });
+}
+
+QFuture<LinkQueryResult> AsyncDatabase::healthTargets(qint64 checkedBefore)
+{
+    return QtConcurrent::run(&pool_, [checkedBefore]() {
+        return runRepositoryQuery([checkedBefore](LinkRepository *links, QList<LinkRecord> *records,
+                                                  QString *errorMessage) {
+            return links->healthTargets(checkedBefore, records, errorMessage);
+        });
+    });
+}
+
+QFuture<LinkHealthResult> AsyncDatabase::loadHealth()
+{
+    return QtConcurrent::run(&pool_, []() {
+        LinkHealthResult result;
+        auto *links = DatabaseManager::repository(&result.errorMessage);
+        result.ok = links && links->listHealth(&result.results, &result.errorMessage);
+        return result;
+    });
+}
+
+QFuture<DatabaseResult> AsyncDatabase::saveHealth(const QList<LinkHealth> &results)
+{
+    return QtConcurrent::run(&pool_, [results]() { return saveHealthResults(results); });
+}
+
+QFuture<LinkFrecencyResult> AsyncDatabase::recordVisits(const QList<LinkVisit> &visits)
+{
+    return QtConcurrent::run(&pool_, [visits]() { return recordVisitBatch(visits); });
+}
+
+QFuture<LinkFrecencyResult> AsyncDatabase::loadFrecency()
+{
+    return QtConcurrent::run(&pool_, []() {
+        LinkFrecencyResult result;
+        auto *links = DatabaseManager::repository(&result.errorMessage);
+        result.ok = links && links->listFrecency(&result.entries, &result.errorMessage);
+        return result;
+    });
+}
+
+QFuture<ImportResult> AsyncDatabase::importFile(const QString &path)
+{
+    importCancelled_ = false;
+    return QtConcurrent::run(&pool_, [this, path]() {
+        ImportResult result;
+        auto db = openDatabase(&result.errorMessage);
+        if (!db.isValid()) {
+            result.ok = false;
+            return result;
+        }
+
+        return LinkImporter::importFile(db, path, [this](qint64 bytesRead, qint64 totalBytes, qint64 imported) {
+            emit importProgress(bytesRead, totalBytes, imported);
+            return !importCancelled_;
+        });
+    });
+}
+
+void AsyncDatabase::cancelImport()
+{
+    importCancelled_ = true;
+}
+
+QFuture<ExportResult> AsyncDatabase::exportFile(const QString &path, LinkExporter::Format format)
+{
+    exportCancelled_ = false;
+    return QtConcurrent::run(&backgroundPool_, [this, path, format]() {
+        return runExport(path, format, [this](qint64 exported, qint64 total) {
+            emit exportProgress(exported, total);
+            return !exportCancelled_;
+        });
+    });
+}
+
+void AsyncDatabase::cancelExport()
+{
+    exportCancelled_ = true;
+}
+
+QFuture<DatabaseResult> AsyncDatabase::backup(const QString &path)
+{
+    return QtConcurrent::run(&backgroundPool_, [path]() { return runBackup(path); });
+}
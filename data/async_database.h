@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+
+#include <QFuture>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QVariantList>
+
+#include "../models/link_change_set.h"
+#include "../models/link_health.h"
+#include "frecency.h"
+#include "link_exporter.h"
+#include "link_importer.h"
+#include "usage_log.h"
+
+struct DatabaseResult {
+    bool ok = true;
+    QString errorMessage;
+};
+
+struct LinkQueryResult {
+    bool ok = true;
+    QString errorMessage;
+    QList<LinkRecord> records;
+};
+
+struct LinkChangesResult {
+    bool ok = true;
+    QString errorMessage;
+    LinkChangeSet changes;
+    // Newest change sequence covered by changes; pass it to the next call.
+    qint64 sequence = 0;
+};
+
+struct LinkHealthResult {
+    bool ok = true;
+    QString errorMessage;
+    QList<LinkHealth> results;
+};
+
+struct LinkFrecencyResult {
+    bool ok = true;
+    QString errorMessage;
+    QList<LinkFrecency> entries;
+};
+
+// A set of writes committed together in one transaction.
+struct LinkBatch {
+    QList<qint64> removed;
+    QList<LinkRecord> updated;
+    QList<LinkItem> inserted;
+
+    bool isEmpty() const
+    {
+        return removed.isEmpty() && updated.isEmpty() && inserted.isEmpty();
+    }
+};
+
+struct LinkBatchResult {
+    bool ok = true;
+    QString errorMessage;
+    // Generated ids, in the same order as LinkBatch::inserted.
+    QList<qint64> insertedIds;
+};
+
+// Runs all SQLite work on one dedicated worker thread that owns its own
+// connection. Every call returns immediately; results arrive through the
+// returned future (see Futures::whenFinished).
+class AsyncDatabase : public QObject {
+    Q_OBJECT
+
+public:
+    explicit AsyncDatabase(QObject *parent = nullptr);
+    ~AsyncDatabase();
+
+    QFuture<DatabaseResult> open();
+    // Re-applies DatabaseManager::storageProfile() to the worker connection.
+    QFuture<DatabaseResult> applyStorageProfile();
+    QFuture<DatabaseResult> runMaintenance();
+
+    QFuture<LinkQueryResult> loadAll();
+    // A negative limit returns every row after afterId.
+    QFuture<LinkQueryResult> loadPage(qint64 afterId, int limit);
+    // sql must select id, title, category and url, in that order, optionally
+    // followed by title_sortkey.
+    QFuture<LinkQueryResult> query(const QString &sql, const QVariantList &bindings = {});
+    // Ranked full-text prefix search; see LinkSearch::matchExpression().
+    QFuture<LinkQueryResult> search(const QString &text, int limit);
+    // Saved links with the same canonical URL; see LinkRepository::findByUrl().
+    QFuture<LinkQueryResult> findByUrl(const QString &url);
+
+    // Rows changed after sequence, read from the trigger-maintained change
+    // log. A negative sequence returns only the current sequence.
+    QFuture<LinkChangesResult> changesSince(qint64 sequence);
+    // Like changesSince(), but returns nothing without touching the log
+    // unless another connection committed since the previous poll.
+    QFuture<LinkChangesResult> pollChanges(qint64 sequence);
+
+    QFuture<LinkBatchResult> insert(const LinkItem &link);
+    QFuture<LinkBatchResult> update(const LinkRecord &record);
+    QFuture<LinkBatchResult> remove(qint64 id);
+    QFuture<LinkBatchResult> commit(const LinkBatch &batch);
+
+    // Links due for a health check; see LinkRepository::healthTargets().
+    QFuture<LinkQueryResult> healthTargets(qint64 checkedBefore);
+    QFuture<LinkHealthResult> loadHealth();
+    // Writes one batch of LinkHealthChecker results in a single transaction.
+    QFuture<DatabaseResult> saveHealth(const QList<LinkHealth> &results);
+
+    // Writes a drained UsageLog in one transaction and returns the new rank
+    // key of every link visited; visits to deleted links are dropped.
+    QFuture<LinkFrecencyResult> recordVisits(const QList<LinkVisit> &visits);
+    QFuture<LinkFrecencyResult> loadFrecency();
+
+    // Streams a bookmark file into the database; see LinkImporter. Progress is
+    // reported through importProgress() from the worker thread.
+    QFuture<ImportResult> importFile(const QString &path);
+    void cancelImport();
+
+    // Long read-only jobs. They run outside the worker on a connection of
+    // their own, so loads and saves are not queued behind them.
+    QFuture<ExportResult> exportFile(const QString &path, LinkExporter::Format format);
+    void cancelExport();
+    QFuture<DatabaseResult> backup(const QString &path);
+
+signals:
+    void importProgress(qint64 bytesRead, qint64 totalBytes, qint64 imported);
+    void exportProgress(qint64 exported, qint64 total);
+
+private:
+    QThreadPool pool_;
+    QThreadPool backgroundPool_;
+    std::atomic_bool importCancelled_{false};
+    std::atomic_bool exportCancelled_{false};
+    // PRAGMA data_version seen by the last poll; only used on the worker thread.
+    qint64 lastDataVersion_ = -1;
+};
@@ -2,20 +2,265 @@
 
 #include <QDir>
 #include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QThread>
+#include <cstddef>
+#include <memory>
+#include "../tracing.h"
 #include "../utilities.h"
+#include "link_repository.h"
+#include "link_schema.h"
+#include "link_urls.h"
 
 namespace {
-const char *kInitSql = R"SQL(
+const char *const kInitSql[] = {
+    R"SQL(
 CREATE TABLE IF NOT EXISTS links (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
     title TEXT NOT NULL,
     category TEXT NOT NULL,
     url TEXT NOT NULL
-);
-CREATE INDEX IF NOT EXISTS idx_links_category ON links(category);
-)SQL";
+)
+)SQL",
+    "CREATE INDEX IF NOT EXISTS idx_links_category ON links(category)",
+};
+
+// v2: external-content FTS5 index over links, kept in sync by triggers.
+const char *const kSearchIndexSql[] = {
+    R"SQL(
+CREATE VIRTUAL TABLE IF NOT EXISTS links_fts USING fts5(
+    title,
+    category,
+    url,
+    content='links',
+    content_rowid='id',
+    tokenize='unicode61 remove_diacritics 2',
+    prefix='2 3'
+)
+)SQL",
+    R"SQL(
+CREATE TRIGGER IF NOT EXISTS links_fts_insert AFTER INSERT ON links BEGIN
+    INSERT INTO links_fts(rowid, title, category, url) VALUES (new.id, new.title, new.category, new.url);
+END
+)SQL",
+    R"SQL(
+CREATE TRIGGER IF NOT EXISTS links_fts_delete AFTER DELETE ON links BEGIN
+    INSERT INTO links_fts(links_fts, rowid, title, category, url) VALUES ('delete', old.id, old.title, old.category, old.url);
+END
+)SQL",
+    R"SQL(
+CREATE TRIGGER IF NOT EXISTS links_fts_update AFTER UPDATE ON links BEGIN
+    INSERT INTO links_fts(links_fts, rowid, title, category, url) VALUES ('delete', old.id, old.title, old.category, old.url);
+    INSERT INTO links_fts(rowid, title, category, url) VALUES (new.id, new.title, new.category, new.url);
+END
+)SQL",
+    "INSERT INTO links_fts(links_fts) VALUES ('rebuild')",
+};
+
+// v3: categories move into their own table and links reference them by id.
+// links has to be rebuilt to drop its category column, and the FTS index is
+// recreated over links_view because its content table needs that column.
+const char *const kNormalizeSetupSql[] = {
+    "DROP TRIGGER IF EXISTS links_fts_insert",
+    "DROP TRIGGER IF EXISTS links_fts_delete",
+    "DROP TRIGGER IF EXISTS links_fts_update",
+    "DROP TABLE IF EXISTS links_fts",
+    R"SQL(
+CREATE TABLE categories (
+    id INTEGER PRIMARY KEY,
+    name TEXT NOT NULL UNIQUE,
+    sort_key TEXT NOT NULL
+)
+)SQL",
+    R"SQL(
+CREATE TABLE links_v3 (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    title TEXT NOT NULL,
+    title_sortkey TEXT NOT NULL,
+    category_id INTEGER NOT NULL REFERENCES categories(id),
+    url TEXT NOT NULL
+)
+)SQL",
+};
+
+const char *const kNormalizeFinishSql[] = {
+    R"SQL(
+INSERT INTO sqlite_sequence (name, seq)
+    SELECT 'links_v3', 0 WHERE NOT EXISTS (SELECT 1 FROM sqlite_sequence WHERE name = 'links_v3')
+)SQL",
+    R"SQL(
+UPDATE sqlite_sequence
+    SET seq = max(seq, coalesce((SELECT seq FROM sqlite_sequence WHERE name = 'links'), 0))
+    WHERE name = 'links_v3'
+)SQL",
+    "DROP TABLE links",
+    "ALTER TABLE links_v3 RENAME TO links",
+    "CREATE INDEX idx_links_category_title ON links(category_id, title_sortkey)",
+    R"SQL(
+CREATE VIEW links_view AS
+    SELECT links.id AS id,
+           links.title AS title,
+           categories.name AS category,
+           links.url AS url,
+           links.category_id AS category_id,
+           categories.sort_key AS category_sortkey,
+           links.title_sortkey AS title_sortkey
+    FROM links JOIN categories ON categories.id = links.category_id
+)SQL",
+    R"SQL(
+CREATE VIRTUAL TABLE links_fts USING fts5(
+    title,
+    category,
+    url,
+    content='links_view',
+    content_rowid='id',
+    tokenize='unicode61 remove_diacritics 2',
+    prefix='2 3'
+)
+)SQL",
+    R"SQL(
+CREATE TRIGGER links_fts_insert AFTER INSERT ON links BEGIN
+    INSERT INTO links_fts(rowid, title, category, url)
+    VALUES (new.id, new.title, (SELECT name FROM categories WHERE id = new.category_id), new.url);
+END
+)SQL",
+    R"SQL(
+CREATE TRIGGER links_fts_delete AFTER DELETE ON links BEGIN
+    INSERT INTO links_fts(links_fts, rowid, title, category, url)
+    VALUES ('delete', old.id, old.title, (SELECT name FROM categories WHERE id = old.category_id), old.url);
+END
+)SQL",
+    R"SQL(
+CREATE TRIGGER links_fts_update AFTER UPDATE ON links BEGIN
+    INSERT INTO links_fts(links_fts, rowid, title, category, url)
+    VALUES ('delete', old.id, old.title, (SELECT name FROM categories WHERE id = old.category_id), old.url);
+    INSERT INTO links_fts(rowid, title, category, url)
+    VALUES (new.id, new.title, (SELECT name FROM categories WHERE id = new.category_id), new.url);
+END
+)SQL",
+    "INSERT INTO links_fts(links_fts) VALUES ('rebuild')",
+};
+
+// v4: sort keys become byte-comparable collation keys (LinkSchema::sortKey).
+// The FTS update trigger is narrowed to the indexed columns first, so
+// rewriting keys does not churn the index.
+const char *const kSortKeyTriggerSql[] = {
+    "DROP TRIGGER IF EXISTS links_fts_update",
+    R"SQL(
+CREATE TRIGGER links_fts_update AFTER UPDATE OF title, category_id, url ON links BEGIN
+    INSERT INTO links_fts(links_fts, rowid, title, category, url)
+    VALUES ('delete', old.id, old.title, (SELECT name FROM categories WHERE id = old.category_id), old.url);
+    INSERT INTO links_fts(rowid, title, category, url)
+    VALUES (new.id, new.title, (SELECT name FROM categories WHERE id = new.category_id), new.url);
+END
+)SQL",
+};
+
+// v5: every write to links stamps the row with the next change sequence,
+// so readers can pull exactly what changed since the sequence they last saw.
+// Deleted rows keep their entry; the missing links row marks the delete.
+const char *const kChangeLogSql[] = {
+    R"SQL(
+CREATE TABLE IF NOT EXISTS link_changes (
+    link_id INTEGER PRIMARY KEY,
+    seq INTEGER NOT NULL
+)
+)SQL",
+    "CREATE UNIQUE INDEX IF NOT EXISTS idx_link_changes_seq ON link_changes(seq)",
+    R"SQL(
+CREATE TRIGGER links_changes_insert AFTER INSERT ON links BEGIN
+    INSERT OR REPLACE INTO link_changes(link_id, seq)
+    VALUES (new.id, (SELECT COALESCE(MAX(seq), 0) + 1 FROM link_changes));
+END
+)SQL",
+    R"SQL(
+CREATE TRIGGER links_changes_update AFTER UPDATE OF title, category_id, url ON links BEGIN
+    INSERT OR REPLACE INTO link_changes(link_id, seq)
+    VALUES (new.id, (SELECT COALESCE(MAX(seq), 0) + 1 FROM link_changes));
+END
+)SQL",
+    R"SQL(
+CREATE TRIGGER links_changes_delete AFTER DELETE ON links BEGIN
+    INSERT OR REPLACE INTO link_changes(link_id, seq)
+    VALUES (old.id, (SELECT COALESCE(MAX(seq), 0) + 1 FROM link_changes));
+END
+)SQL",
+};
+
+// v6: links carry LinkUrls::hash() of their URL, indexed for duplicate
+// lookups. The index is not unique because existing files hold duplicates.
+const char *const kUrlHashSql[] = {
+    "ALTER TABLE links ADD COLUMN url_hash INTEGER NOT NULL DEFAULT 0",
+    "CREATE INDEX IF NOT EXISTS idx_links_url_hash ON links(url_hash)",
+};
+
+// v7: results of the link health checker, one row per checked link. Rows
+// go away with their link, and a new URL needs a new check.
+const char *const kHealthSql[] = {
+    R"SQL(
+CREATE TABLE IF NOT EXISTS link_health (
+    link_id INTEGER PRIMARY KEY,
+    status INTEGER NOT NULL,
+    latency_ms INTEGER NOT NULL,
+    checked_at INTEGER NOT NULL,
+    error TEXT NOT NULL DEFAULT ''
+)
+)SQL",
+    R"SQL(
+CREATE TRIGGER links_health_delete AFTER DELETE ON links BEGIN
+    DELETE FROM link_health WHERE link_id = old.id;
+END
+)SQL",
+    R"SQL(
+CREATE TRIGGER links_health_url AFTER UPDATE OF url ON links WHEN new.url IS NOT old.url BEGIN
+    DELETE FROM link_health WHERE link_id = old.id;
+END
+)SQL",
+};
+
+// v8: frecency rank keys of visited links; see Frecency.
+const char *const kFrecencySql[] = {
+    R"SQL(
+CREATE TABLE IF NOT EXISTS link_frecency (
+    link_id INTEGER PRIMARY KEY,
+    rank_key REAL NOT NULL,
+    visits INTEGER NOT NULL,
+    last_visit INTEGER NOT NULL
+)
+)SQL",
+    R"SQL(
+CREATE TRIGGER links_frecency_delete AFTER DELETE ON links BEGIN
+    DELETE FROM link_frecency WHERE link_id = old.id;
+END
+)SQL",
+};
+
+// v9: a URL changed by a tool that leaves url_hash alone gets hash 0, so
+// LinkRepository::refreshUrlHashes() rehashes it. Writes from this code
+// base change url_hash along with the URL and skip the trigger, unless the
+// canonical form stayed the same; the refresh after a commit catches those.
+const char *const kStaleUrlHashSql[] = {
+    R"SQL(
+CREATE TRIGGER links_url_hash_stale AFTER UPDATE OF url ON links
+WHEN new.url IS NOT old.url AND new.url_hash = old.url_hash BEGIN
+    UPDATE links SET url_hash = 0 WHERE id = new.id;
+END
+)SQL",
+};
+
+QMutex profileMutex;
+StorageProfile currentProfile;
+// Connections are per thread, and so are the statements prepared on them.
+thread_local std::unique_ptr<LinkRepository> threadRepository;
+
+QString &databasePathOverride()
+{
+    static QString path;
+    return path;
+}
 
 QString formatError(const QString &context, const QSqlError &error)
 {
@@ -24,12 +269,30 @@ QString formatError(const QString &context, const QSqlError &error)
     }
     return context + ": " + error.text();
 }
+
+// Scripts are lists of single statements, so nothing has to split SQL text.
+template <std::size_t N>
+bool runScript(QSqlDatabase &db, const char *const (&statements)[N], QString *errorMessage)
+{
+    QSqlQuery query(db);
+    for (const auto *statement : statements) {
+        if (!query.exec(QString::fromUtf8(statement).trimmed())) {
+            if (errorMessage) {
+                *errorMessage = formatError("Failed to run schema script", query.lastError());
+            }
+            return false;
+        }
+    }
+    return true;
+}
 }
 
 bool DatabaseManager::initialize(QString *errorMessage)
 {
-    if (QSqlDatabase::contains(kConnectionName)) {
-        auto existing = QSqlDatabase::database(kConnectionName);
+    const Tracing::Span span("DatabaseManager::initialize");
+    const auto name = connectionName();
+    if (QSqlDatabase::contains(name)) {
+        auto existing = QSqlDatabase::database(name);
         if (existing.isOpen()) {
             return true;
         }
@@ -45,10 +308,10 @@ bool DatabaseManager::initialize(QString *errorMessage)
             return false;
         }
 
-        return ensureSchema(existing, errorMessage);
+        return configureConnection(existing, errorMessage) && ensureSchema(existing, errorMessage);
     }
 
-    auto db = QSqlDatabase::addDatabase("QSQLITE", kConnectionName);
+    auto db = QSqlDatabase::addDatabase("QSQLITE", name);
     if (!db.isValid()) {
         if (errorMessage) {
             *errorMessage = "Failed to load SQLite driver.";
@@ -81,24 +344,151 @@ bool DatabaseManager::initialize(QString *errorMessage)
         return false;
     }
 
-    return ensureSchema(db, errorMessage);
+    return configureConnection(db, errorMessage) && ensureSchema(db, errorMessage);
 }
 
 QSqlDatabase DatabaseManager::database()
 {
-    if (!QSqlDatabase::contains(kConnectionName)) {
+    const auto name = connectionName();
+    if (!QSqlDatabase::contains(name)) {
         return {};
     }
-    return QSqlDatabase::database(kConnectionName);
+    return QSqlDatabase::database(name);
 }
 
 QString DatabaseManager::databaseFilePath()
 {
+    if (!databasePathOverride().isEmpty()) {
+        return databasePathOverride();
+    }
     return AppPaths::appDataPath("linksdash.sqlite");
 }
 
+void DatabaseManager::setDatabaseFilePath(const QString &path)
+{
+    databasePathOverride() = path;
+}
+
+LinkRepository *DatabaseManager::repository(QString *errorMessage)
+{
+    if (!threadRepository) {
+        const auto db = database();
+        if (!db.isValid() || !db.isOpen()) {
+            if (errorMessage) {
+                *errorMessage = "Database is not open.";
+            }
+            return nullptr;
+        }
+        threadRepository = std::make_unique<LinkRepository>(db);
+    }
+    return threadRepository.get();
+}
+
+void DatabaseManager::close()
+{
+    // Prepared statements must be finalized before the connection goes away.
+    threadRepository.reset();
+    const auto name = connectionName();
+    if (!QSqlDatabase::contains(name)) {
+        return;
+    }
+    {
+        auto db = QSqlDatabase::database(name, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+
+QString DatabaseManager::connectionName()
+{
+    // QSqlDatabase connections may only be used from the thread that created them.
+    const auto threadId = reinterpret_cast<quintptr>(QThread::currentThread());
+    return QString(kConnectionName) + "-" + QString::number(threadId, 16);
+}
+
+void DatabaseManager::setStorageProfile(const StorageProfile &profile)
+{
+    QMutexLocker locker(&profileMutex);
+    currentProfile = profile;
+}
+
+StorageProfile DatabaseManager::storageProfile()
+{
+    QMutexLocker locker(&profileMutex);
+    return currentProfile;
+}
+
+bool DatabaseManager::applyStorageProfile(QString *errorMessage)
+{
+    auto db = database();
+    if (!db.isValid() || !db.isOpen()) {
+        if (errorMessage) {
+            *errorMessage = "Database is not open.";
+        }
+        return false;
+    }
+    return configureConnection(db, errorMessage);
+}
+
+bool DatabaseManager::runMaintenance(QString *errorMessage)
+{
+    auto db = database();
+    if (!db.isValid() || !db.isOpen()) {
+        if (errorMessage) {
+            *errorMessage = "Database is not open.";
+        }
+        return false;
+    }
+
+    QSqlQuery query(db);
+    if ((storageProfile().walJournal && !query.exec("PRAGMA wal_checkpoint(PASSIVE);"))
+        || !query.exec("PRAGMA optimize;")) {
+        if (errorMessage) {
+            *errorMessage = formatError("Database maintenance failed", query.lastError());
+        }
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::configureConnection(QSqlDatabase &db, QString *errorMessage)
+{
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA foreign_keys = ON;")) {
+        if (errorMessage) {
+            *errorMessage = formatError("Failed to configure database", query.lastError());
+        }
+        return false;
+    }
+
+    // Tuning is best effort: a pragma the file or build rejects (WAL on a
+    // network share, say) leaves a slower but working connection.
+    for (const auto &pragma : storageProfile().pragmas()) {
+        if (!query.exec(pragma)) {
+            qWarning("%s failed: %s", qPrintable(pragma), qPrintable(query.lastError().text()));
+        }
+    }
+    return true;
+}
+
 bool DatabaseManager::ensureSchema(QSqlDatabase &db, QString *errorMessage)
 {
+    const Tracing::Span span("DatabaseManager::ensureSchema");
+    // One step per schema version, applied in order from the file's version.
+    static const Migration kMigrations[] = {
+        {1, &DatabaseManager::createLinksTable},
+        {2, &DatabaseManager::createSearchIndex},
+        {3, &DatabaseManager::normalizeCategories},
+        {4, &DatabaseManager::recomputeSortKeys},
+        {5, &DatabaseManager::createChangeLog},
+        {6, &DatabaseManager::addUrlHashes},
+        {7, &DatabaseManager::createHealthTable},
+        {8, &DatabaseManager::createFrecencyTable},
+        {9, &DatabaseManager::createUrlHashTrigger},
+    };
+    static_assert(sizeof(kMigrations) / sizeof(kMigrations[0]) == kSchemaVersion,
+                  "every schema version needs a migration step");
+
     const int version = userVersion(db, errorMessage);
     if (version < 0) {
         return false;
@@ -111,32 +501,187 @@ bool DatabaseManager::ensureSchema(QSqlDatabase &db, QString *errorMessage)
         return false;
     }
 
-    if (version == 0) {
-        if (!execSql(db, kInitSql, errorMessage)) {
+    if (version == kSchemaVersion) {
+        return true;
+    }
+
+    // All pending steps share one transaction, so a failed upgrade leaves
+    // the file exactly as it was.
+    if (!db.transaction()) {
+        if (errorMessage) {
+            *errorMessage = formatError("Failed to start schema upgrade", db.lastError());
+        }
+        return false;
+    }
+
+    for (const auto &migration : kMigrations) {
+        if (migration.version <= version) {
+            continue;
+        }
+        if (!migration.apply(db, errorMessage) || !setUserVersion(db, migration.version, errorMessage)) {
+            db.rollback();
             return false;
         }
-        return setUserVersion(db, kSchemaVersion, errorMessage);
     }
 
+    if (!db.commit()) {
+        if (errorMessage) {
+            *errorMessage = formatError("Failed to commit schema upgrade", db.lastError());
+        }
+        db.rollback();
+        return false;
+    }
     return true;
 }
 
-bool DatabaseManager::execSql(QSqlDatabase &db, const QString &sql, QString *errorMessage)
+bool DatabaseManager::createLinksTable(QSqlDatabase &db, QString *errorMessage)
 {
-    const auto statements = sql.split(';', Qt::SkipEmptyParts);
-    for (const auto &statement : statements) {
-        const auto trimmed = statement.trimmed();
-        if (trimmed.isEmpty()) {
-            continue;
+    return runScript(db, kInitSql, errorMessage);
+}
+
+bool DatabaseManager::createSearchIndex(QSqlDatabase &db, QString *errorMessage)
+{
+    return runScript(db, kSearchIndexSql, errorMessage);
+}
+
+bool DatabaseManager::normalizeCategories(QSqlDatabase &db, QString *errorMessage)
+{
+    if (!runScript(db, kNormalizeSetupSql, errorMessage)) {
+        return false;
+    }
+
+    // Sort keys are computed in C++, so rows are copied here rather than
+    // with INSERT ... SELECT.
+    QSqlQuery source(db);
+    source.setForwardOnly(true);
+    QSqlQuery insert(db);
+    if (!source.exec("SELECT id, title, category, url FROM links;")
+        || !insert.prepare("INSERT INTO links_v3 (id, title, title_sortkey, category_id, url) VALUES (?, ?, ?, ?, ?);")) {
+        if (errorMessage) {
+            const auto error = source.lastError().isValid() ? source.lastError() : insert.lastError();
+            *errorMessage = formatError("Failed to migrate links", error);
+        }
+        return false;
+    }
+
+    LinkSchema::CategoryResolver categories(db);
+    QString resolveError;
+    while (source.next()) {
+        const auto title = source.value(1).toString();
+        const qint64 categoryId = categories.idFor(source.value(2).toString(), &resolveError);
+        if (categoryId < 0) {
+            if (errorMessage) {
+                *errorMessage = "Failed to migrate links: " + resolveError;
+            }
+            return false;
         }
-        QSqlQuery query(db);
-        if (!query.exec(trimmed)) {
+
+        insert.bindValue(0, source.value(0));
+        insert.bindValue(1, title);
+        insert.bindValue(2, LinkSchema::sortKey(title));
+        insert.bindValue(3, categoryId);
+        insert.bindValue(4, source.value(3));
+        if (!insert.exec()) {
             if (errorMessage) {
-                *errorMessage = formatError("Failed to run init script", query.lastError());
+                *errorMessage = formatError("Failed to migrate links", insert.lastError());
             }
             return false;
         }
     }
+    source.finish();
+    insert.finish();
+
+    return runScript(db, kNormalizeFinishSql, errorMessage);
+}
+
+bool DatabaseManager::createChangeLog(QSqlDatabase &db, QString *errorMessage)
+{
+    return runScript(db, kChangeLogSql, errorMessage);
+}
+
+bool DatabaseManager::addUrlHashes(QSqlDatabase &db, QString *errorMessage)
+{
+    if (!runScript(db, kUrlHashSql, errorMessage)) {
+        return false;
+    }
+
+    // Only url_hash changes, so neither the FTS nor the change log triggers fire.
+    QSqlQuery source(db);
+    source.setForwardOnly(true);
+    QSqlQuery update(db);
+    if (!source.exec("SELECT id, url FROM links;") || !update.prepare("UPDATE links SET url_hash = ? WHERE id = ?;")) {
+        if (errorMessage) {
+            const auto error = source.lastError().isValid() ? source.lastError() : update.lastError();
+            *errorMessage = formatError("Failed to hash URLs", error);
+        }
+        return false;
+    }
+
+    while (source.next()) {
+        update.bindValue(0, LinkUrls::hash(source.value(1).toString()));
+        update.bindValue(1, source.value(0));
+        if (!update.exec()) {
+            if (errorMessage) {
+                *errorMessage = formatError("Failed to hash URLs", update.lastError());
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::createHealthTable(QSqlDatabase &db, QString *errorMessage)
+{
+    return runScript(db, kHealthSql, errorMessage);
+}
+
+bool DatabaseManager::createFrecencyTable(QSqlDatabase &db, QString *errorMessage)
+{
+    return runScript(db, kFrecencySql, errorMessage);
+}
+
+bool DatabaseManager::createUrlHashTrigger(QSqlDatabase &db, QString *errorMessage)
+{
+    return runScript(db, kStaleUrlHashSql, errorMessage);
+}
+
+bool DatabaseManager::recomputeSortKeys(QSqlDatabase &db, QString *errorMessage)
+{
+    if (!runScript(db, kSortKeyTriggerSql, errorMessage)) {
+        return false;
+    }
+
+    const struct {
+        const char *selectSql;
+        const char *updateSql;
+    } tables[] = {
+        {"SELECT id, name FROM categories;", "UPDATE categories SET sort_key = ? WHERE id = ?;"},
+        {"SELECT id, title FROM links;", "UPDATE links SET title_sortkey = ? WHERE id = ?;"},
+    };
+
+    for (const auto &table : tables) {
+        QSqlQuery source(db);
+        source.setForwardOnly(true);
+        QSqlQuery update(db);
+        if (!source.exec(table.selectSql) || !update.prepare(table.updateSql)) {
+            if (errorMessage) {
+                const auto error = source.lastError().isValid() ? source.lastError() : update.lastError();
+                *errorMessage = formatError("Failed to update sort keys", error);
+            }
+            return false;
+        }
+
+        while (source.next()) {
+            update.bindValue(0, LinkSchema::sortKey(source.value(1).toString()));
+            update.bindValue(1, source.value(0));
+            if (!update.exec()) {
+                if (errorMessage) {
+                    *errorMessage = formatError("Failed to update sort keys", update.lastError());
+                }
+                return false;
+            }
+        }
+    }
     return true;
 }
 
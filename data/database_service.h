@@ -3,18 +3,52 @@
 #include <QSqlDatabase>
 #include <QString>
 
+#include "storage_profile.h"
+
+class LinkRepository;
+
 class DatabaseManager {
 public:
     static bool initialize(QString *errorMessage = nullptr);
     static QSqlDatabase database();
     static QString databaseFilePath();
+    // Points new connections at another file; call before initialize(). Used by tools and benchmarks.
+    static void setDatabaseFilePath(const QString &path);
+    // Typed access with cached prepared statements on the calling thread's
+    // connection. Owned by DatabaseManager and destroyed by close().
+    static LinkRepository *repository(QString *errorMessage = nullptr);
+    static void close();
+
+    // Used by every connection opened afterwards. applyStorageProfile()
+    // re-runs the pragmas on the calling thread's open connection.
+    static void setStorageProfile(const StorageProfile &profile);
+    static StorageProfile storageProfile();
+    static bool applyStorageProfile(QString *errorMessage = nullptr);
+    // Checkpoints the WAL and refreshes planner statistics; cheap when idle.
+    static bool runMaintenance(QString *errorMessage = nullptr);
 
 private:
+    using MigrationStep = bool (*)(QSqlDatabase &db, QString *errorMessage);
+    struct Migration {
+        int version;
+        MigrationStep apply;
+    };
+
+    static QString connectionName();
+    static bool configureConnection(QSqlDatabase &db, QString *errorMessage);
     static bool ensureSchema(QSqlDatabase &db, QString *errorMessage);
-    static bool execSql(QSqlDatabase &db, const QString &sql, QString *errorMessage);
+    static bool createLinksTable(QSqlDatabase &db, QString *errorMessage);
+    static bool createSearchIndex(QSqlDatabase &db, QString *errorMessage);
+    static bool normalizeCategories(QSqlDatabase &db, QString *errorMessage);
+    static bool recomputeSortKeys(QSqlDatabase &db, QString *errorMessage);
+    static bool createChangeLog(QSqlDatabase &db, QString *errorMessage);
+    static bool addUrlHashes(QSqlDatabase &db, QString *errorMessage);
+    static bool createHealthTable(QSqlDatabase &db, QString *errorMessage);
+    static bool createFrecencyTable(QSqlDatabase &db, QString *errorMessage);
+    static bool createUrlHashTrigger(QSqlDatabase &db, QString *errorMessage);
     static int userVersion(QSqlDatabase &db, QString *errorMessage);
     static bool setUserVersion(QSqlDatabase &db, int version, QString *errorMessage);
 
-    static constexpr int kSchemaVersion = 1;
+    static constexpr int kSchemaVersion = 9;
     static constexpr const char *kConnectionName = "linksdash";
 };
@@ -0,0 +1,163 @@
+#include "frecency.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Frecency {
+    double visitKey(qint64 visitedAt)
+    {
+        return visitedAt / kHalfLifeSecs;
+    }
+
+    double addVisit(double key, qint64 visitedAt)
+    {
+        // log2(2^a + 2^b) without overflowing either power.
+        const double visit = visitKey(visitedAt);
+        const double high = std::max(key, visit);
+        const double low = std::min(key, visit);
+        return high + std::log2(1.0 + std::exp2(low - high));
+    }
+
+    double score(double key, qint64 now)
+    {
+        return std::exp2(key - visitKey(now));
+    }
+} // namespace Frecency
+
+FrecencyRanking::FrecencyRanking(int capacity)
+    : capacity_(qMax(1, capacity))
+{
+}
+
+void FrecencyRanking::reset(const QList<LinkFrecency> &entries)
+{
+    entries_.clear();
+    entries_.reserve(entries.size());
+    for (const auto &entry : entries) {
+        entries_.insert(entry.record.id, entry);
+    }
+    rebuildHeap();
+}
+
+bool FrecencyRanking::update(const LinkFrecency &entry)
+{
+    const qint64 id = entry.record.id;
+    entries_.insert(id, entry);
+
+    const int index = heapIndex(id);
+    if (index >= 0) {
+        heap_[index].first = entry.rankKey;
+        siftDown(index);
+        siftUp(index);
+        return true;
+    }
+    if (static_cast<int>(heap_.size()) < capacity_) {
+        heap_.emplace_back(entry.rankKey, id);
+        siftUp(static_cast<int>(heap_.size()) - 1);
+        return true;
+    }
+    if (entry.rankKey <= heap_.front().first) {
+        return false;
+    }
+    heap_.front() = {entry.rankKey, id};
+    siftDown(0);
+    return true;
+}
+
+bool FrecencyRanking::apply(const LinkChangeSet &changes)
+{
+    bool changed = false;
+    for (const auto *list : {&changes.inserted, &changes.updated}) {
+        for (const auto &record : *list) {
+            const auto it = entries_.find(record.id);
+            if (it == entries_.end()) {
+                continue;
+            }
+            it->record = record;
+            changed = heapIndex(record.id) >= 0 || changed;
+        }
+    }
+
+    bool removedTop = false;
+    for (const auto id : changes.removed) {
+        if (entries_.remove(id) > 0 && heapIndex(id) >= 0) {
+            removedTop = true;
+        }
+    }
+    if (removedTop) {
+        // The next best link is only known by scanning the rest.
+        rebuildHeap();
+    }
+    return changed || removedTop;
+}
+
+QList<LinkRecord> FrecencyRanking::top() const
+{
+    auto ordered = heap_;
+    std::sort(ordered.begin(), ordered.end(), [](const auto &a, const auto &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    QList<LinkRecord> records;
+    records.reserve(static_cast<int>(ordered.size()));
+    for (const auto &item : ordered) {
+        records.append(entries_.value(item.second).record);
+    }
+    return records;
+}
+
+void FrecencyRanking::rebuildHeap()
+{
+    heap_.clear();
+    heap_.reserve(capacity_);
+    for (auto it = entries_.cbegin(); it != entries_.cend(); ++it) {
+        const std::pair<double, qint64> item(it->rankKey, it.key());
+        if (static_cast<int>(heap_.size()) < capacity_) {
+            heap_.push_back(item);
+            siftUp(static_cast<int>(heap_.size()) - 1);
+        } else if (item.first > heap_.front().first) {
+            heap_.front() = item;
+            siftDown(0);
+        }
+    }
+}
+
+int FrecencyRanking::heapIndex(qint64 id) const
+{
+    for (int i = 0; i < static_cast<int>(heap_.size()); ++i) {
+        if (heap_[i].second == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void FrecencyRanking::siftDown(int index)
+{
+    const int size = static_cast<int>(heap_.size());
+    while (true) {
+        int smallest = index;
+        for (const int child : {2 * index + 1, 2 * index + 2}) {
+            if (child < size && heap_[child].first < heap_[smallest].first) {
+                smallest = child;
+            }
+        }
+        if (smallest == index) {
+            return;
+        }
+        std::swap(heap_[index], heap_[smallest]);
+        index = smallest;
+    }
+}
+
+void FrecencyRanking::siftUp(int index)
+{
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+        if (heap_[parent].first <= heap_[index].first) {
+            return;
+        }
+        std::swap(heap_[parent], heap_[index]);
+        index = parent;
+    }
+}
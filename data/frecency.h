@@ -0,0 +1,59 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <QHash>
+#include <QList>
+
+#include "../models/link_change_set.h"
+
+// Frecency: every visit adds 1 to a link's score, and scores halve every
+// kHalfLifeSecs. Scores are stored as a time-independent rank key,
+// log2(sum of 2^(visit time / half-life)), so one visit updates a key
+// incrementally and keys can be compared, indexed and ranked without ever
+// decaying the whole table.
+namespace Frecency {
+constexpr double kHalfLifeSecs = 30.0 * 24 * 60 * 60;
+
+double visitKey(qint64 visitedAt);
+// Key after one more visit; pass visitKey() of the first visit for a new link.
+double addVisit(double key, qint64 visitedAt);
+// Decayed score as of now, for display.
+double score(double key, qint64 now);
+}
+
+struct LinkFrecency {
+    LinkRecord record;
+    double rankKey = 0;
+};
+
+// The top-K links by rank key, kept in a min-heap so a visit costs
+// O(log K) instead of a sort of every scored link. Keys only grow with new
+// visits; only removing a top link needs a rescan of the rest.
+class FrecencyRanking {
+public:
+    explicit FrecencyRanking(int capacity = kDefaultCapacity);
+
+    void reset(const QList<LinkFrecency> &entries);
+    // Returns true when the top list changed.
+    bool update(const LinkFrecency &entry);
+    // Title and URL edits and removals; returns true when the top list changed.
+    bool apply(const LinkChangeSet &changes);
+
+    // Best first.
+    QList<LinkRecord> top() const;
+
+    static constexpr int kDefaultCapacity = 10;
+
+private:
+    void rebuildHeap();
+    int heapIndex(qint64 id) const;
+    void siftDown(int index);
+    void siftUp(int index);
+
+    int capacity_ = kDefaultCapacity;
+    QHash<qint64, LinkFrecency> entries_;
+    // Min-heap of (rank key, id): the weakest top link sits at the front.
+    std::vector<std::pair<double, qint64>> heap_;
+};
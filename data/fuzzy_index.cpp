@@ -0,0 +1,209 @@
+#include "fuzzy_index.h"
+
+#include "fuzzy_kernel.h"
+#include "link_schema.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <QPair>
+
+namespace {
+constexpr int kMaxCandidateLength = 0xffff;
+
+bool isWordBoundary(char byte)
+{
+    switch (byte) {
+    case ' ':
+    case '/':
+    case '.':
+    case '-':
+    case '_':
+    case ':':
+    case '\n':
+        return true;
+    default:
+        return false;
+    }
+}
+
+QByteArray foldForMatching(const QString &text)
+{
+    return text.trimmed().toCaseFolded().toUtf8();
+}
+}
+
+void FuzzyIndex::build(const QList<LinkRecord> &records)
+{
+    arena_.clear();
+    candidates_.clear();
+    records_.clear();
+    slots_.clear();
+    deadCount_ = 0;
+
+    candidates_.reserve(records.size());
+    records_.reserve(records.size());
+    slots_.reserve(records.size());
+    for (const auto &record : records) {
+        append(record);
+    }
+}
+
+void FuzzyIndex::apply(const LinkChangeSet &changes)
+{
+    for (const auto id : changes.removed) {
+        remove(id);
+    }
+    for (const auto &record : changes.updated) {
+        remove(record.id);
+        append(record);
+    }
+    for (const auto &record : changes.inserted) {
+        // A rebuild may already contain the row.
+        remove(record.id);
+        append(record);
+    }
+
+    // Dead entries still cost a mask check per search; drop them once they dominate.
+    if (deadCount_ > candidates_.size() / 2) {
+        compact();
+    }
+}
+
+int FuzzyIndex::size() const
+{
+    return candidates_.size() - deadCount_;
+}
+
+QList<LinkRecord> FuzzyIndex::search(const QString &query, int limit) const
+{
+    QByteArray pattern = foldForMatching(query);
+    pattern.replace(' ', QByteArray());
+    if (pattern.isEmpty() || limit <= 0) {
+        return {};
+    }
+
+    const quint64 patternMask = FuzzyKernel::charMask(pattern.constData(), pattern.size());
+
+    QVector<QPair<int, int>> matches;
+    for (int i = 0; i < candidates_.size(); ++i) {
+        const auto &candidate = candidates_.at(i);
+        if (!candidate.alive || (candidate.mask & patternMask) != patternMask
+            || candidate.length < pattern.size()) {
+            continue;
+        }
+        const int value = score(candidate, pattern);
+        if (value != std::numeric_limits<int>::min()) {
+            matches.append({value, i});
+        }
+    }
+
+    const auto better = [this](const QPair<int, int> &left, const QPair<int, int> &right) {
+        if (left.first != right.first) {
+            return left.first > right.first;
+        }
+        const auto &leftRecord = records_.at(left.second);
+        const auto &rightRecord = records_.at(right.second);
+        const int order = leftRecord.sortKey.compare(rightRecord.sortKey);
+        return order != 0 ? order < 0 : leftRecord.id < rightRecord.id;
+    };
+    const int count = std::min<int>(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), better);
+
+    QList<LinkRecord> results;
+    results.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        results.append(records_.at(matches.at(i).second));
+    }
+    return results;
+}
+
+void FuzzyIndex::append(const LinkRecord &record)
+{
+    const auto title = foldForMatching(record.link.title);
+    const auto url = foldForMatching(record.link.url);
+    if (title.isEmpty() || url.isEmpty()) {
+        return;
+    }
+
+    QByteArray text = title + '\n' + url;
+    text.truncate(kMaxCandidateLength);
+
+    Candidate candidate;
+    candidate.offset = static_cast<quint32>(arena_.size());
+    candidate.length = static_cast<quint16>(text.size());
+    candidate.titleLength = static_cast<quint16>(std::min<int>(title.size(), text.size()));
+    candidate.mask = FuzzyKernel::charMask(text.constData(), text.size());
+    candidate.alive = true;
+
+    arena_.append(text);
+    slots_.insert(record.id, candidates_.size());
+    candidates_.append(candidate);
+    records_.append(record);
+    if (records_.last().sortKey.isEmpty()) {
+        records_.last().sortKey = LinkSchema::sortKey(record.link.title);
+    }
+}
+
+void FuzzyIndex::remove(qint64 id)
+{
+    const auto slot = slots_.find(id);
+    if (slot == slots_.end()) {
+        return;
+    }
+
+    candidates_[slot.value()].alive = false;
+    ++deadCount_;
+    slots_.erase(slot);
+}
+
+void FuzzyIndex::compact()
+{
+    QList<LinkRecord> live;
+    live.reserve(size());
+    for (int i = 0; i < candidates_.size(); ++i) {
+        if (candidates_.at(i).alive) {
+            live.append(records_.at(i));
+        }
+    }
+    build(live);
+}
+
+// Greedy left-to-right match. Rewards matches at word starts, runs of
+// consecutive characters and hits inside the title; penalises gaps.
+int FuzzyIndex::score(const Candidate &candidate, const QByteArray &pattern) const
+{
+    const char *text = arena_.constData() + candidate.offset;
+    const int length = candidate.length;
+
+    int total = 0;
+    int position = 0;
+    int previous = -2;
+    for (const char byte : pattern) {
+        const int index = FuzzyKernel::findByte(text, position, length, byte);
+        if (index < 0) {
+            return std::numeric_limits<int>::min();
+        }
+
+        int bonus = 16;
+        if (index == 0 || isWordBoundary(text[index - 1])) {
+            bonus += 24;
+        }
+        if (index == previous + 1) {
+            bonus += 16;
+        }
+        if (index < candidate.titleLength) {
+            bonus += 8;
+        }
+        if (previous >= 0) {
+            bonus -= std::min(index - previous - 1, 12);
+        }
+
+        total += bonus;
+        previous = index;
+        position = index + 1;
+    }
+
+    // Prefer shorter candidates among otherwise equal matches.
+    return total - length / 8;
+}
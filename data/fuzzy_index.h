@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+#include "../models/link_change_set.h"
+
+// In-memory fuzzy matcher over link titles and URLs. Every link is packed into
+// one case-folded UTF-8 arena as "title\nurl"; a query matches when its
+// characters appear in order. Candidates are screened with a character mask
+// before the SIMD subsequence scan in FuzzyKernel.
+class FuzzyIndex {
+public:
+    void build(const QList<LinkRecord> &records);
+    void apply(const LinkChangeSet &changes);
+
+    int size() const;
+    // Best matches first, at most limit results.
+    QList<LinkRecord> search(const QString &query, int limit) const;
+
+private:
+    struct Candidate {
+        quint64 mask = 0;
+        quint32 offset = 0;
+        quint16 length = 0;
+        quint16 titleLength = 0;
+        bool alive = false;
+    };
+
+    void append(const LinkRecord &record);
+    void remove(qint64 id);
+    void compact();
+    int score(const Candidate &candidate, const QByteArray &pattern) const;
+
+    QByteArray arena_;
+    QVector<Candidate> candidates_;
+    QVector<LinkRecord> records_;
+    QHash<qint64, int> slots_;
+    int deadCount_ = 0;
+};
@@ -0,0 +1,114 @@
+#include "fuzzy_kernel.h"
+
+#include <QtAlgorithms>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LINKSDASH_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LINKSDASH_HAVE_AVX2_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace {
+int findByteScalar(const char *data, int from, int size, char needle)
+{
+    for (int i = from; i < size; ++i) {
+        if (data[i] == needle) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#if defined(LINKSDASH_HAVE_SSE2)
+int findByteSse2(const char *data, int from, int size, char needle)
+{
+    const __m128i pattern = _mm_set1_epi8(needle);
+    int i = from;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const auto bits = static_cast<quint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, pattern)));
+        if (bits != 0) {
+            return i + static_cast<int>(qCountTrailingZeroBits(bits));
+        }
+    }
+    return findByteScalar(data, i, size, needle);
+}
+#endif
+
+#if defined(LINKSDASH_HAVE_AVX2_DISPATCH)
+__attribute__((target("avx2"))) int findByteAvx2(const char *data, int from, int size, char needle)
+{
+    const __m256i pattern = _mm256_set1_epi8(needle);
+    int i = from;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const auto bits = static_cast<quint32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, pattern)));
+        if (bits != 0) {
+            return i + static_cast<int>(qCountTrailingZeroBits(bits));
+        }
+    }
+    return findByteScalar(data, i, size, needle);
+}
+#endif
+
+using FindByteFunction = int (*)(const char *, int, int, char);
+
+struct Implementation {
+    FindByteFunction findByte;
+    const char *name;
+};
+
+Implementation selectImplementation()
+{
+#if defined(LINKSDASH_HAVE_AVX2_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {findByteAvx2, "avx2"};
+    }
+#endif
+#if defined(LINKSDASH_HAVE_SSE2)
+    return {findByteSse2, "sse2"};
+#else
+    return {findByteScalar, "scalar"};
+#endif
+}
+
+const Implementation &implementation()
+{
+    static const Implementation selected = selectImplementation();
+    return selected;
+}
+
+int maskBit(unsigned char byte)
+{
+    if (byte >= 'a' && byte <= 'z') {
+        return byte - 'a';
+    }
+    if (byte >= '0' && byte <= '9') {
+        return 26 + (byte - '0');
+    }
+    return 36 + (byte % 28);
+}
+}
+
+namespace FuzzyKernel {
+    int findByte(const char *data, int from, int size, char needle) {
+        return implementation().findByte(data, from, size, needle);
+    }
+
+    quint64 charMask(const char *data, int size) {
+        quint64 mask = 0;
+        for (int i = 0; i < size; ++i) {
+            mask |= quint64(1) << maskBit(static_cast<unsigned char>(data[i]));
+        }
+        return mask;
+    }
+
+    const char *implementationName() {
+        return implementation().name;
+    }
+} // namespace FuzzyKernel
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Byte-level primitives for the fuzzy matcher. Inputs are case-folded UTF-8.
+namespace FuzzyKernel {
+// Index of the first needle in data[from, size), or -1. Uses AVX2 or SSE2 when
+// the CPU has them and falls back to a scalar loop otherwise.
+int findByte(const char *data, int from, int size, char needle);
+
+// 64-bit presence mask of the bytes in data, used to reject candidates that
+// cannot contain every query character before scanning them.
+quint64 charMask(const char *data, int size);
+
+// Name of the findByte implementation picked for this CPU.
+const char *implementationName();
+}
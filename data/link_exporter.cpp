@@ -0,0 +1,273 @@
+#include "link_exporter.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+
+namespace {
+const char *kCountSql = "SELECT COUNT(*) FROM links;";
+// Categories in sort order, links by title within each; HTML relies on each
+// category's rows being contiguous.
+const char *kExportSql =
+    "SELECT links.title, categories.name, links.url FROM categories "
+    "JOIN links ON links.category_id = categories.id "
+    "ORDER BY categories.sort_key, categories.id, links.title_sortkey;";
+
+QByteArray csvField(const QString &value)
+{
+    auto bytes = value.toUtf8();
+    if (bytes.contains(',') || bytes.contains('"') || bytes.contains('\n') || bytes.contains('\r')) {
+        bytes.replace("\"", "\"\"");
+        return '"' + bytes + '"';
+    }
+    return bytes;
+}
+
+QByteArray jsonString(const QString &value)
+{
+    // Escaping works on the UTF-8 bytes: every escaped character is ASCII
+    // and every byte of a multi-byte sequence is >= 0x80, so surrogate pairs
+    // stay intact and runs without escapes are copied in one go.
+    const QByteArray utf8 = value.toUtf8();
+    QByteArray out;
+    out.reserve(utf8.size() + 2);
+    out += '"';
+    const char *run = utf8.constData();
+    const char *const end = run + utf8.size();
+    for (const char *c = run; c != end; ++c) {
+        const auto byte = static_cast<unsigned char>(*c);
+        if (byte >= 0x20 && byte != '"' && byte != '\\') {
+            continue;
+        }
+        out.append(run, static_cast<int>(c - run));
+        run = c + 1;
+        switch (byte) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            out += "\\u" + QByteArray::number(byte, 16).rightJustified(4, '0');
+            break;
+        }
+    }
+    out.append(run, static_cast<int>(end - run));
+    out += '"';
+    return out;
+}
+
+QByteArray htmlEscaped(const QString &value)
+{
+    return value.toHtmlEscaped().toUtf8();
+}
+
+// Formats rows into a buffer and hands it to the file once it is large enough.
+class ChunkWriter {
+public:
+    explicit ChunkWriter(QSaveFile &file)
+        : file_(file)
+    {
+        buffer_.reserve(LinkExporter::kChunkSize + 4096);
+    }
+
+    void append(const QByteArray &bytes)
+    {
+        buffer_ += bytes;
+    }
+
+    bool flushIfFull()
+    {
+        return buffer_.size() < LinkExporter::kChunkSize || flush();
+    }
+
+    bool flush()
+    {
+        if (buffer_.isEmpty()) {
+            return true;
+        }
+        const bool ok = file_.write(buffer_) == buffer_.size();
+        buffer_.clear();
+        return ok;
+    }
+
+private:
+    QSaveFile &file_;
+    QByteArray buffer_;
+};
+}
+
+LinkExporter::Format LinkExporter::formatForPath(const QString &path)
+{
+    const auto suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "json") {
+        return Format::Json;
+    }
+    if (suffix == "html" || suffix == "htm") {
+        return Format::NetscapeHtml;
+    }
+    return Format::Csv;
+}
+
+ExportResult LinkExporter::exportToFile(QSqlDatabase &db, const QString &path, Format format,
+                                        const ProgressCallback &progress)
+{
+    ExportResult result;
+
+    qint64 total = 0;
+    QSqlQuery count(db);
+    if (count.exec(kCountSql) && count.next()) {
+        total = count.value(0).toLongLong();
+    }
+    count.finish();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec(kExportSql)) {
+        result.ok = false;
+        result.errorMessage = query.lastError().text();
+        return result;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        result.ok = false;
+        result.errorMessage = "Failed to open " + path + ": " + file.errorString();
+        return result;
+    }
+
+    ChunkWriter writer(file);
+    QString currentCategory;
+    bool firstRow = true;
+
+    switch (format) {
+    case Format::Csv:
+        writer.append("title,category,url\n");
+        break;
+    case Format::Json:
+        writer.append("[\n");
+        break;
+    case Format::NetscapeHtml:
+        writer.append("<!DOCTYPE NETSCAPE-Bookmark-file-1>\n"
+                      "<META HTTP-EQUIV=\"Content-Type\" CONTENT=\"text/html; charset=UTF-8\">\n"
+                      "<TITLE>Bookmarks</TITLE>\n"
+                      "<H1>Bookmarks</H1>\n"
+                      "<DL><p>\n");
+        break;
+    }
+
+    while (query.next()) {
+        const auto title = query.value(0).toString();
+        const auto category = query.value(1).toString();
+        const auto url = query.value(2).toString();
+
+        switch (format) {
+        case Format::Csv:
+            writer.append(csvField(title) + ',' + csvField(category) + ',' + csvField(url) + '\n');
+            break;
+        case Format::Json:
+            writer.append((firstRow ? "  {\"title\": " : ",\n  {\"title\": ") + jsonString(title)
+                          + ", \"category\": " + jsonString(category)
+                          + ", \"url\": " + jsonString(url) + '}');
+            break;
+        case Format::NetscapeHtml:
+            if (firstRow || category != currentCategory) {
+                if (!firstRow) {
+                    writer.append("    </DL><p>\n");
+                }
+                writer.append("    <DT><H3>" + htmlEscaped(category) + "</H3>\n    <DL><p>\n");
+                currentCategory = category;
+            }
+            writer.append("        <DT><A HREF=\"" + htmlEscaped(url) + "\">" + htmlEscaped(title) + "</A>\n");
+            break;
+        }
+        firstRow = false;
+        ++result.exported;
+
+        if (!writer.flushIfFull()) {
+            result.ok = false;
+            result.errorMessage = file.errorString();
+            file.cancelWriting();
+            return result;
+        }
+        if (progress && result.exported % kProgressInterval == 0 && !progress(result.exported, total)) {
+            result.cancelled = true;
+            file.cancelWriting();
+            return result;
+        }
+    }
+
+    if (query.lastError().isValid()) {
+        result.ok = false;
+        result.errorMessage = query.lastError().text();
+        file.cancelWriting();
+        return result;
+    }
+
+    switch (format) {
+    case Format::Csv:
+        break;
+    case Format::Json:
+        writer.append(firstRow ? "]\n" : "\n]\n");
+        break;
+    case Format::NetscapeHtml:
+        writer.append(firstRow ? "</DL><p>\n" : "    </DL><p>\n</DL><p>\n");
+        break;
+    }
+
+    if (!writer.flush() || !file.commit()) {
+        result.ok = false;
+        result.errorMessage = file.errorString();
+        return result;
+    }
+
+    if (progress) {
+        progress(result.exported, total);
+    }
+    return result;
+}
+
+bool LinkExporter::backup(QSqlDatabase &db, const QString &path, QString *errorMessage)
+{
+    // VACUUM INTO refuses to overwrite, so write next to the target and swap.
+    const auto temporaryPath = path + ".partial";
+    QFile::remove(temporaryPath);
+
+    QSqlQuery query(db);
+    query.prepare("VACUUM INTO ?;");
+    query.bindValue(0, temporaryPath);
+    if (!query.exec()) {
+        if (errorMessage) {
+            *errorMessage = query.lastError().text();
+        }
+        QFile::remove(temporaryPath);
+        return false;
+    }
+
+    if (QFile::exists(path) && !QFile::remove(path)) {
+        if (errorMessage) {
+            *errorMessage = "Failed to replace " + path + ".";
+        }
+        QFile::remove(temporaryPath);
+        return false;
+    }
+    if (!QFile::rename(temporaryPath, path)) {
+        if (errorMessage) {
+            *errorMessage = "Failed to move backup to " + path + ".";
+        }
+        return false;
+    }
+    return true;
+}
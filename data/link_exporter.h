@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+
+#include <QSqlDatabase>
+#include <QString>
+
+struct ExportResult {
+    bool ok = true;
+    bool cancelled = false;
+    QString errorMessage;
+    qint64 exported = 0;
+};
+
+// Streams the links table straight from a forward-only query into CSV, JSON
+// or Netscape bookmark HTML, writing in fixed-size chunks so memory stays
+// flat regardless of row count. The output round-trips through LinkImporter.
+class LinkExporter {
+public:
+    enum class Format {
+        Csv,
+        Json,
+        NetscapeHtml
+    };
+
+    // Called periodically; return false to cancel. A cancelled export leaves no file.
+    using ProgressCallback = std::function<bool(qint64 exported, qint64 total)>;
+
+    static Format formatForPath(const QString &path);
+    static ExportResult exportToFile(QSqlDatabase &db, const QString &path, Format format,
+                                     const ProgressCallback &progress = {});
+
+    // Consistent copy of the live database taken with VACUUM INTO. It reads
+    // through one snapshot, so the source stays usable while it runs.
+    static bool backup(QSqlDatabase &db, const QString &path, QString *errorMessage);
+
+    static constexpr int kChunkSize = 256 * 1024;
+    static constexpr int kProgressInterval = 5000;
+};
@@ -0,0 +1,285 @@
+#include "link_groups.h"
+
+#include "link_schema.h"
+#include "tray_snapshot.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+const char *kUncategorized = "Uncategorized";
+
+bool normalizeRecord(const LinkRecord &record, LinkRecord *normalized)
+{
+    normalized->id = record.id;
+    normalized->link.title = record.link.title.trimmed();
+    normalized->link.url = record.link.url.trimmed();
+    const auto category = record.link.category.trimmed();
+    normalized->link.category = category.isEmpty() ? QString(kUncategorized) : category;
+    // Stored keys were computed from the title as written, so only reuse them
+    // when trimming changed nothing.
+    normalized->sortKey = normalized->link.title.size() == record.link.title.size() && !record.sortKey.isEmpty()
+        ? record.sortKey
+        : LinkSchema::sortKey(normalized->link.title);
+    return !normalized->link.title.isEmpty() && !normalized->link.url.isEmpty();
+}
+}
+
+void LinkGroups::reset(const QList<LinkRecord> &records)
+{
+    clear();
+    locations_.reserve(records.size());
+
+    // Bucket by interned category id, so grouping costs an array index per
+    // link instead of a map lookup by key.
+    std::vector<QList<Entry>> buckets;
+    for (const auto &record : records) {
+        Entry entry;
+        quint32 categoryId = 0;
+        if (!makeEntry(record, &entry, &categoryId)) {
+            continue;
+        }
+        if (categoryId >= buckets.size()) {
+            buckets.resize(categoryId + 1);
+        }
+        buckets[categoryId].append(entry);
+        locations_.insert(entry.id, {categoryId, entry.sortKey});
+    }
+
+    for (quint32 categoryId = 0; categoryId < buckets.size(); ++categoryId) {
+        auto &bucket = buckets[categoryId];
+        if (bucket.isEmpty()) {
+            continue;
+        }
+        // Group keys end with the exact name, so names that differ only in
+        // case still get groups of their own.
+        auto &group = ensureGroup(categoryId);
+        if (group.entries.isEmpty()) {
+            group.entries = std::move(bucket);
+        } else {
+            group.entries.append(bucket);
+        }
+    }
+
+    const auto less = [this](const Entry &left, const Entry &right) { return lessThan(left, right); };
+    for (auto &group : groups_) {
+        std::sort(group.entries.begin(), group.entries.end(), less);
+    }
+}
+
+void LinkGroups::restore(const TraySnapshot &snapshot)
+{
+    clear();
+    locations_.reserve(snapshot.linkCount());
+
+    for (int index = 0; index < snapshot.groupCount(); ++index) {
+        const auto key = snapshot.groupKey(index);
+        Group group;
+        group.category = snapshot.category(index);
+        const auto categoryId = categories_.intern(group.category);
+        if (categoryId >= static_cast<quint32>(groupKeys_.size())) {
+            groupKeys_.resize(static_cast<int>(categoryId) + 1);
+        }
+        groupKeys_[static_cast<int>(categoryId)] = key;
+
+        const int count = snapshot.entryCount(index);
+        group.entries.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            const auto stored = snapshot.entry(index, i);
+            Entry entry;
+            entry.id = stored.id;
+            entry.sortKey = strings_.add(stored.sortKey);
+            entry.title = strings_.add(stored.title);
+            entry.url = strings_.add(stored.url);
+            locations_.insert(entry.id, {categoryId, entry.sortKey});
+            group.entries.append(entry);
+        }
+        groups_.insert(key, group);
+    }
+}
+
+QSet<QByteArray> LinkGroups::apply(const LinkChangeSet &changes)
+{
+    QSet<QByteArray> changed;
+    QByteArray groupKey;
+    for (const auto id : changes.removed) {
+        if (removeLink(id, &groupKey)) {
+            changed.insert(groupKey);
+        }
+    }
+    for (const auto &record : changes.updated) {
+        if (removeLink(record.id, &groupKey)) {
+            changed.insert(groupKey);
+        }
+        if (insertLink(record, &groupKey)) {
+            changed.insert(groupKey);
+        }
+    }
+    for (const auto &record : changes.inserted) {
+        // A reload may already contain the row.
+        if (locations_.contains(record.id) && removeLink(record.id, &groupKey)) {
+            changed.insert(groupKey);
+        }
+        if (insertLink(record, &groupKey)) {
+            changed.insert(groupKey);
+        }
+    }
+
+    if (strings_.needsCompaction()) {
+        compactStrings();
+    }
+    return changed;
+}
+
+void LinkGroups::clear()
+{
+    groups_.clear();
+    locations_.clear();
+    strings_.clear();
+    categories_.clear();
+    groupKeys_.clear();
+}
+
+const QMap<QByteArray, LinkGroups::Group> &LinkGroups::groups() const
+{
+    return groups_;
+}
+
+bool LinkGroups::isEmpty() const
+{
+    return groups_.isEmpty();
+}
+
+int LinkGroups::linkCount() const
+{
+    return locations_.size();
+}
+
+QString LinkGroups::title(const Entry &entry) const
+{
+    return strings_.text(entry.title);
+}
+
+QString LinkGroups::url(const Entry &entry) const
+{
+    return strings_.text(entry.url);
+}
+
+const StringArena &LinkGroups::strings() const
+{
+    return strings_;
+}
+
+bool LinkGroups::makeEntry(const LinkRecord &record, Entry *entry, quint32 *categoryId)
+{
+    LinkRecord normalized;
+    if (!normalizeRecord(record, &normalized)) {
+        return false;
+    }
+
+    entry->id = normalized.id;
+    entry->sortKey = strings_.add(normalized.sortKey);
+    entry->title = strings_.add(normalized.link.title);
+    entry->url = strings_.add(normalized.link.url);
+    *categoryId = internCategory(normalized.link.category);
+    return true;
+}
+
+bool LinkGroups::lessThan(const Entry &left, const Entry &right) const
+{
+    const int order = strings_.compare(left.sortKey, right.sortKey);
+    if (order != 0) {
+        return order < 0;
+    }
+    return left.id < right.id;
+}
+
+bool LinkGroups::insertLink(const LinkRecord &record, QByteArray *groupKey)
+{
+    Entry entry;
+    quint32 categoryId = 0;
+    if (!makeEntry(record, &entry, &categoryId)) {
+        return false;
+    }
+
+    *groupKey = groupKeys_.at(static_cast<int>(categoryId));
+    auto &entries = ensureGroup(categoryId).entries;
+    const auto position = std::lower_bound(entries.begin(), entries.end(), entry,
+                                           [this](const Entry &left, const Entry &right) {
+                                               return lessThan(left, right);
+                                           });
+    entries.insert(position, entry);
+    locations_.insert(entry.id, {categoryId, entry.sortKey});
+    return true;
+}
+
+bool LinkGroups::removeLink(qint64 id, QByteArray *groupKey)
+{
+    const auto location = locations_.find(id);
+    if (location == locations_.end()) {
+        return false;
+    }
+
+    Entry probe;
+    probe.sortKey = location->sortKey;
+    probe.id = id;
+    *groupKey = groupKeys_.value(static_cast<int>(location->categoryId));
+    locations_.erase(location);
+
+    const auto groupIt = groups_.find(*groupKey);
+    if (groupIt == groups_.end()) {
+        return false;
+    }
+
+    auto &entries = groupIt->entries;
+    const auto position = std::lower_bound(entries.begin(), entries.end(), probe,
+                                           [this](const Entry &left, const Entry &right) {
+                                               return lessThan(left, right);
+                                           });
+    if (position == entries.end() || position->id != id) {
+        return false;
+    }
+    strings_.release(position->sortKey);
+    strings_.release(position->title);
+    strings_.release(position->url);
+    entries.erase(position);
+
+    if (entries.isEmpty()) {
+        groups_.erase(groupIt);
+    }
+    return true;
+}
+
+quint32 LinkGroups::internCategory(const QString &category)
+{
+    const auto categoryId = categories_.intern(category);
+    if (categoryId >= static_cast<quint32>(groupKeys_.size())) {
+        groupKeys_.resize(static_cast<int>(categoryId) + 1);
+        groupKeys_[static_cast<int>(categoryId)] = LinkSchema::sortKey(category);
+    }
+    return categoryId;
+}
+
+LinkGroups::Group &LinkGroups::ensureGroup(quint32 categoryId)
+{
+    auto &group = groups_[groupKeys_.at(static_cast<int>(categoryId))];
+    if (group.category.isNull()) {
+        group.category = categories_.name(categoryId);
+    }
+    return group;
+}
+
+void LinkGroups::compactStrings()
+{
+    StringArena compacted;
+    for (auto &group : groups_) {
+        for (auto &entry : group.entries) {
+            entry.sortKey = compacted.add(strings_.bytes(entry.sortKey));
+            entry.title = compacted.add(strings_.bytes(entry.title));
+            entry.url = compacted.add(strings_.bytes(entry.url));
+            locations_[entry.id].sortKey = entry.sortKey;
+        }
+    }
+    strings_ = compacted;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include "../models/link_change_set.h"
+#include "string_pool.h"
+
+class TraySnapshot;
+
+// Links grouped by category, each group kept sorted by title. This is the
+// data behind the tray menu, kept free of UI types so it can be driven and
+// profiled headless. Groups and entries are ordered by LinkSchema::sortKey(),
+// so every comparison is a plain byte compare. Blank categories are grouped
+// as "Uncategorized" and links without a title or URL are left out.
+//
+// Titles, URLs and sort keys live in one StringArena and categories are
+// interned, so an entry is a small POD view: links are bucketed by category
+// id on reset() and read through title() and url().
+class LinkGroups {
+public:
+    struct Entry {
+        qint64 id = -1;
+        StringArena::Ref sortKey;
+        StringArena::Ref title;
+        StringArena::Ref url;
+    };
+
+    struct Group {
+        QString category;
+        QList<Entry> entries;
+    };
+
+    void reset(const QList<LinkRecord> &records);
+    // Loads groups that were saved already normalized and sorted.
+    void restore(const TraySnapshot &snapshot);
+    // Returns the keys of the groups whose entries changed. A returned key
+    // that is no longer in groups() belongs to a group that became empty.
+    QSet<QByteArray> apply(const LinkChangeSet &changes);
+    void clear();
+
+    // Keyed by the category's sort key.
+    const QMap<QByteArray, Group> &groups() const;
+    bool isEmpty() const;
+    int linkCount() const;
+
+    QString title(const Entry &entry) const;
+    QString url(const Entry &entry) const;
+    // The arena behind every entry, for writing its bytes out unconverted.
+    const StringArena &strings() const;
+
+private:
+    struct Location {
+        quint32 categoryId = 0;
+        StringArena::Ref sortKey;
+    };
+
+    bool makeEntry(const LinkRecord &record, Entry *entry, quint32 *categoryId);
+    bool lessThan(const Entry &left, const Entry &right) const;
+    bool insertLink(const LinkRecord &record, QByteArray *groupKey);
+    bool removeLink(qint64 id, QByteArray *groupKey);
+    quint32 internCategory(const QString &category);
+    Group &ensureGroup(quint32 categoryId);
+    void compactStrings();
+
+    QMap<QByteArray, Group> groups_;
+    QHash<qint64, Location> locations_;
+    StringArena strings_;
+    CategoryPool categories_;
+    // Group key of each category id.
+    QVector<QByteArray> groupKeys_;
+};
@@ -0,0 +1,236 @@
+#include "link_health_checker.h"
+
+#include <QDateTime>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QUrl>
+
+#include <utility>
+
+namespace {
+constexpr int kMaxRedirects = 5;
+const char *kUserAgent = "LinksDash link checker";
+
+bool isHttp(const QUrl &url)
+{
+    return url.isValid() && (url.scheme() == "http" || url.scheme() == "https") && !url.host().isEmpty();
+}
+}
+
+LinkHealthChecker::LinkHealthChecker(QObject *parent)
+    : QObject(parent)
+{
+    reportTimer_.setInterval(kReportIntervalMs);
+    connect(&reportTimer_, &QTimer::timeout, this, &LinkHealthChecker::flush);
+}
+
+void LinkHealthChecker::setMaxConcurrent(int count)
+{
+    maxConcurrent_ = qMax(1, count);
+}
+
+void LinkHealthChecker::setMaxPerHost(int count)
+{
+    maxPerHost_ = qMax(1, count);
+}
+
+void LinkHealthChecker::setTimeout(int milliseconds)
+{
+    timeoutMs_ = qMax(1, milliseconds);
+}
+
+void LinkHealthChecker::start(const QList<LinkRecord> &targets)
+{
+    cancel();
+
+    running_ = true;
+    total_ = static_cast<int>(targets.size());
+    done_ = 0;
+    for (const auto &target : targets) {
+        const auto url = QUrl::fromUserInput(target.link.url);
+        if (!isHttp(url)) {
+            ++done_;
+            continue;
+        }
+        queues_[url.host()].enqueue(target);
+    }
+    for (auto it = queues_.cbegin(); it != queues_.cend(); ++it) {
+        readyHosts_.enqueue(it.key());
+        readySet_.insert(it.key());
+    }
+
+    reportTimer_.start();
+    emit progress(done_, total_);
+    pump();
+    finishIfIdle();
+}
+
+void LinkHealthChecker::cancel()
+{
+    if (!running_) {
+        return;
+    }
+
+    running_ = false;
+    queues_.clear();
+    readyHosts_.clear();
+    readySet_.clear();
+    activePerHost_.clear();
+    // Aborting emits finished(), which must find nothing left to handle.
+    const auto replies = inFlight_.keys();
+    inFlight_.clear();
+    for (auto *reply : replies) {
+        reply->abort();
+        reply->deleteLater();
+    }
+
+    flush();
+    reportTimer_.stop();
+    emit finished(true);
+}
+
+bool LinkHealthChecker::isRunning() const
+{
+    return running_;
+}
+
+void LinkHealthChecker::pump()
+{
+    while (inFlight_.size() < maxConcurrent_ && !readyHosts_.isEmpty()) {
+        const auto host = readyHosts_.dequeue();
+        readySet_.remove(host);
+
+        const auto queue = queues_.find(host);
+        if (queue == queues_.end()) {
+            continue;
+        }
+
+        Probe probe;
+        probe.target = queue->dequeue();
+        probe.host = host;
+        const int active = ++activePerHost_[host];
+        if (queue->isEmpty()) {
+            queues_.erase(queue);
+        } else if (active < maxPerHost_) {
+            readyHosts_.enqueue(host);
+            readySet_.insert(host);
+        }
+        send(std::move(probe));
+    }
+}
+
+void LinkHealthChecker::send(Probe probe)
+{
+    QNetworkRequest request(QUrl::fromUserInput(probe.target.link.url));
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    request.setMaximumRedirectsAllowed(kMaxRedirects);
+    request.setHeader(QNetworkRequest::UserAgentHeader, kUserAgent);
+
+    probe.timer.start();
+    auto *reply = probe.get ? network_.get(request) : network_.head(request);
+    const bool get = probe.get;
+    inFlight_.insert(reply, std::move(probe));
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() { handleFinished(reply); });
+    if (get) {
+        // Only the status matters, so stop as soon as the headers arrive
+        // instead of waiting for body bytes. Redirects being followed also
+        // report headers; those are left to finish.
+        connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply]() {
+            const auto it = inFlight_.find(reply);
+            const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (it != inFlight_.end() && status > 0 && (status < 300 || status >= 400)) {
+                it->status = status;
+                reply->abort();
+            }
+        });
+    }
+    QTimer::singleShot(timeoutMs_, reply, [this, reply]() {
+        const auto it = inFlight_.find(reply);
+        if (it != inFlight_.end()) {
+            it->timedOut = true;
+            reply->abort();
+        }
+    });
+}
+
+void LinkHealthChecker::handleFinished(QNetworkReply *reply)
+{
+    const auto it = inFlight_.find(reply);
+    if (it == inFlight_.end()) {
+        return;
+    }
+    Probe probe = std::move(*it);
+    inFlight_.erase(it);
+    reply->deleteLater();
+
+    const int status = probe.status != 0
+        ? probe.status
+        : reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (!probe.get && !probe.timedOut && (status == 405 || status == 501)) {
+        // The host slot stays taken by the retry.
+        probe.get = true;
+        send(std::move(probe));
+        return;
+    }
+
+    LinkHealth health;
+    health.linkId = probe.target.id;
+    health.httpStatus = status;
+    health.latencyMs = static_cast<int>(probe.timer.elapsed());
+    health.checkedAt = QDateTime::currentSecsSinceEpoch();
+    if (status == 0) {
+        health.error = probe.timedOut ? QString("Timed out") : reply->errorString();
+    }
+    record(health);
+    complete(probe.host);
+}
+
+void LinkHealthChecker::complete(const QString &host)
+{
+    const auto active = activePerHost_.find(host);
+    if (active != activePerHost_.end() && --*active <= 0) {
+        activePerHost_.erase(active);
+    }
+    if (queues_.contains(host) && !readySet_.contains(host)) {
+        readyHosts_.enqueue(host);
+        readySet_.insert(host);
+    }
+
+    pump();
+    finishIfIdle();
+}
+
+void LinkHealthChecker::finishIfIdle()
+{
+    if (!running_ || !inFlight_.isEmpty() || !queues_.isEmpty()) {
+        return;
+    }
+
+    running_ = false;
+    readyHosts_.clear();
+    readySet_.clear();
+    activePerHost_.clear();
+    flush();
+    reportTimer_.stop();
+    emit progress(done_, total_);
+    emit finished(false);
+}
+
+void LinkHealthChecker::record(const LinkHealth &health)
+{
+    buffer_.append(health);
+    ++done_;
+    if (buffer_.size() >= kReportBatchSize) {
+        flush();
+    }
+}
+
+void LinkHealthChecker::flush()
+{
+    if (buffer_.isEmpty()) {
+        return;
+    }
+    emit checked(std::exchange(buffer_, {}));
+    emit progress(done_, total_);
+}
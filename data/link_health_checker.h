@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+#include "../models/link_health.h"
+#include "../models/link_item.h"
+
+class QNetworkReply;
+
+// Probes link URLs over HTTP(S) and reports status and latency. Requests go
+// through one QNetworkAccessManager, so connections to a host are kept alive
+// and reused, and never more than maxConcurrent requests are in flight in
+// total or maxPerHost to any one host. Hosts take turns, so one large site
+// cannot hold up the rest of the queue.
+//
+// Each link gets a HEAD request; servers that refuse HEAD get a GET that is
+// aborted as soon as the status line arrives. Results are handed out in
+// batches through checked(), which keeps signal and database traffic low
+// when tens of thousands of links are queued. Links that are not http or
+// https are skipped.
+class LinkHealthChecker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LinkHealthChecker(QObject *parent = nullptr);
+
+    void setMaxConcurrent(int count);
+    void setMaxPerHost(int count);
+    void setTimeout(int milliseconds);
+
+    // Only id and url of each record are used. Replaces any running check.
+    void start(const QList<LinkRecord> &targets);
+    void cancel();
+    bool isRunning() const;
+
+    static constexpr int kDefaultMaxConcurrent = 32;
+    static constexpr int kDefaultMaxPerHost = 2;
+    static constexpr int kDefaultTimeoutMs = 15000;
+    static constexpr int kReportBatchSize = 200;
+    static constexpr int kReportIntervalMs = 1000;
+
+signals:
+    void checked(const QList<LinkHealth> &results);
+    void progress(int done, int total);
+    void finished(bool cancelled);
+
+private:
+    struct Probe {
+        LinkRecord target;
+        QString host;
+        bool get = false;
+        bool timedOut = false;
+        // Set when a GET is aborted on purpose after the status arrived.
+        int status = 0;
+        QElapsedTimer timer;
+    };
+
+    void pump();
+    void send(Probe probe);
+    void handleFinished(QNetworkReply *reply);
+    void complete(const QString &host);
+    void finishIfIdle();
+    void record(const LinkHealth &health);
+    void flush();
+
+    QNetworkAccessManager network_;
+    QTimer reportTimer_;
+    int maxConcurrent_ = kDefaultMaxConcurrent;
+    int maxPerHost_ = kDefaultMaxPerHost;
+    int timeoutMs_ = kDefaultTimeoutMs;
+
+    // Links waiting per host, and the hosts that may start a request now, in
+    // round-robin order. readyHosts_ holds each host at most once.
+    QHash<QString, QQueue<LinkRecord>> queues_;
+    QQueue<QString> readyHosts_;
+    QSet<QString> readySet_;
+    QHash<QString, int> activePerHost_;
+    QHash<QNetworkReply *, Probe> inFlight_;
+
+    QList<LinkHealth> buffer_;
+    int total_ = 0;
+    int done_ = 0;
+    bool running_ = false;
+};
@@ -0,0 +1,677 @@
+#include "link_importer.h"
+
+#include "link_repository.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QRegularExpression>
+#include <QSqlError>
+#include <QStringList>
+#include <QTextStream>
+
+namespace {
+constexpr int kReadChunkSize = 64 * 1024;
+
+using LinkSink = std::function<bool(const LinkItem &)>;
+
+QString decodeEntities(QString text)
+{
+    if (!text.contains('&')) {
+        return text;
+    }
+
+    // Decimal and hex references are matched apart, so "&#1f;" is not read
+    // as hex. References to code points that cannot appear in text stay as
+    // they are.
+    static const QRegularExpression numeric("&#(?:([0-9]+)|[xX]([0-9a-fA-F]+));");
+    auto match = numeric.match(text);
+    while (match.hasMatch()) {
+        const bool decimal = match.capturedStart(1) >= 0;
+        bool ok = false;
+        const uint code = decimal ? match.captured(1).toUInt(&ok, 10) : match.captured(2).toUInt(&ok, 16);
+        if (!ok || code == 0 || code > QChar::LastValidCodePoint || QChar::isSurrogate(code)) {
+            match = numeric.match(text, match.capturedEnd());
+            continue;
+        }
+        const auto replacement = QChar::requiresSurrogates(code)
+            ? QString(QChar(QChar::highSurrogate(code))) + QChar(QChar::lowSurrogate(code))
+            : QString(QChar(static_cast<ushort>(code)));
+        text.replace(match.capturedStart(), match.capturedLength(), replacement);
+        match = numeric.match(text, match.capturedStart() + replacement.size());
+    }
+
+    text.replace("&lt;", "<");
+    text.replace("&gt;", ">");
+    text.replace("&quot;", "\"");
+    text.replace("&#39;", "'");
+    text.replace("&apos;", "'");
+    text.replace("&nbsp;", " ");
+    text.replace("&amp;", "&");
+    return text;
+}
+
+// Writes links through a repository on db, committing every kBatchSize rows.
+class BatchWriter {
+public:
+    explicit BatchWriter(QSqlDatabase &db)
+        : db_(db)
+        , links_(db)
+    {
+    }
+
+    // Sets *duplicate and writes nothing when a link with the same canonical
+    // URL already exists, including one added earlier in this import.
+    bool add(const LinkItem &link, bool *duplicate, QString *errorMessage)
+    {
+        if (!inTransaction_) {
+            if (!db_.transaction()) {
+                *errorMessage = db_.lastError().text();
+                return false;
+            }
+            inTransaction_ = true;
+        }
+
+        QList<LinkRecord> existing;
+        if (!links_.findByUrl(link.url, &existing, errorMessage)) {
+            return false;
+        }
+        *duplicate = !existing.isEmpty();
+        if (*duplicate) {
+            return true;
+        }
+        if (!links_.insert(link, nullptr, errorMessage)) {
+            return false;
+        }
+
+        ++pending_;
+        if (pending_ >= LinkImporter::kBatchSize) {
+            return flush(errorMessage);
+        }
+        return true;
+    }
+
+    bool flush(QString *errorMessage)
+    {
+        if (!inTransaction_) {
+            return true;
+        }
+
+        if (!db_.commit()) {
+            *errorMessage = db_.lastError().text();
+            db_.rollback();
+            links_.discardCaches();
+            inTransaction_ = false;
+            pending_ = 0;
+            return false;
+        }
+        committed_ += pending_;
+        pending_ = 0;
+        inTransaction_ = false;
+        return true;
+    }
+
+    void rollback()
+    {
+        if (inTransaction_) {
+            db_.rollback();
+            links_.discardCaches();
+            inTransaction_ = false;
+            pending_ = 0;
+        }
+    }
+
+    qint64 committed() const
+    {
+        return committed_;
+    }
+
+private:
+    QSqlDatabase &db_;
+    LinkRepository links_;
+    bool inTransaction_ = false;
+    int pending_ = 0;
+    qint64 committed_ = 0;
+};
+
+bool readCsvRecord(QTextStream &in, QStringList *fields)
+{
+    fields->clear();
+    QString field;
+    bool inQuotes = false;
+    bool readAny = false;
+
+    while (!in.atEnd()) {
+        const auto line = in.readLine();
+        readAny = true;
+        for (int i = 0; i < line.size(); ++i) {
+            const QChar c = line.at(i);
+            if (inQuotes) {
+                if (c == '"' && i + 1 < line.size() && line.at(i + 1) == '"') {
+                    field += '"';
+                    ++i;
+                } else if (c == '"') {
+                    inQuotes = false;
+                } else {
+                    field += c;
+                }
+            } else if (c == '"') {
+                inQuotes = true;
+            } else if (c == ',') {
+                fields->append(field);
+                field.clear();
+            } else {
+                field += c;
+            }
+        }
+
+        if (!inQuotes) {
+            fields->append(field);
+            return true;
+        }
+        // A quoted field continues on the next line.
+        field += '\n';
+    }
+
+    if (readAny) {
+        fields->append(field);
+    }
+    return readAny;
+}
+
+bool parseCsv(QTextStream &in, const LinkSink &sink)
+{
+    int titleColumn = 0;
+    int categoryColumn = 1;
+    int urlColumn = 2;
+
+    QStringList fields;
+    bool firstRecord = true;
+    while (readCsvRecord(in, &fields)) {
+        if (firstRecord) {
+            firstRecord = false;
+            QStringList names;
+            for (const auto &field : std::as_const(fields)) {
+                names.append(field.trimmed().toLower());
+            }
+
+            const auto find = [&names](const QStringList &candidates) {
+                for (const auto &candidate : candidates) {
+                    const int index = names.indexOf(candidate);
+                    if (index >= 0) {
+                        return index;
+                    }
+                }
+                return -1;
+            };
+            const int headerUrl = find({"url", "href", "link", "uri"});
+            if (headerUrl >= 0) {
+                urlColumn = headerUrl;
+                titleColumn = find({"title", "name"});
+                categoryColumn = find({"category", "folder", "tags"});
+                continue;
+            }
+            if (fields.size() == 2) {
+                categoryColumn = -1;
+                urlColumn = 1;
+            }
+        }
+
+        const auto value = [&fields](int column) {
+            return column >= 0 && column < fields.size() ? fields.at(column).trimmed() : QString();
+        };
+        if (!sink({value(titleColumn), value(categoryColumn), value(urlColumn)})) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Tag-level scanner for the Netscape bookmark format. <H3> names a folder and
+// the following <DL> opens it; <A HREF> entries inside take the innermost name.
+bool parseNetscapeHtml(QTextStream &in, const LinkSink &sink)
+{
+    static const QRegularExpression hrefPattern("href\\s*=\\s*(?:\"([^\"]*)\"|'([^']*)')",
+                                                QRegularExpression::CaseInsensitiveOption);
+
+    enum class Capture {
+        None,
+        Folder,
+        Link
+    };
+
+    QString buffer;
+    QString text;
+    QString href;
+    QString pendingFolder;
+    QStringList folders;
+    Capture capture = Capture::None;
+
+    const auto currentCategory = [&folders]() {
+        for (auto it = folders.crbegin(); it != folders.crend(); ++it) {
+            if (!it->isEmpty()) {
+                return *it;
+            }
+        }
+        return QString();
+    };
+
+    while (true) {
+        const bool atEnd = in.atEnd();
+        if (!atEnd) {
+            buffer += in.read(kReadChunkSize);
+        }
+
+        int position = 0;
+        while (position < buffer.size()) {
+            const int open = buffer.indexOf('<', position);
+            if (open < 0) {
+                if (capture != Capture::None) {
+                    text += buffer.mid(position);
+                }
+                position = buffer.size();
+                break;
+            }
+            const int close = buffer.indexOf('>', open);
+            if (close < 0) {
+                if (capture != Capture::None) {
+                    text += buffer.mid(position, open - position);
+                }
+                position = atEnd ? buffer.size() : open;
+                break;
+            }
+
+            if (capture != Capture::None) {
+                text += buffer.mid(position, open - position);
+            }
+
+            const auto tag = buffer.mid(open + 1, close - open - 1).trimmed();
+            const bool closing = tag.startsWith('/');
+            const auto name = tag.mid(closing ? 1 : 0).section(' ', 0, 0).toLower();
+
+            if (name == "h3") {
+                if (closing) {
+                    pendingFolder = decodeEntities(text).trimmed();
+                    capture = Capture::None;
+                } else {
+                    capture = Capture::Folder;
+                    text.clear();
+                }
+            } else if (name == "dl") {
+                if (closing) {
+                    if (!folders.isEmpty()) {
+                        folders.removeLast();
+                    }
+                } else {
+                    folders.append(pendingFolder);
+                    pendingFolder.clear();
+                }
+            } else if (name == "a") {
+                if (closing) {
+                    if (capture == Capture::Link) {
+                        const auto url = decodeEntities(href).trimmed();
+                        const auto title = decodeEntities(text).simplified();
+                        if (!sink({title, currentCategory(), url})) {
+                            return false;
+                        }
+                    }
+                    capture = Capture::None;
+                } else {
+                    const auto match = hrefPattern.match(tag);
+                    href = match.hasMatch() ? match.captured(1) + match.captured(2) : QString();
+                    capture = Capture::Link;
+                    text.clear();
+                }
+            }
+
+            position = close + 1;
+        }
+
+        buffer.remove(0, position);
+        if (atEnd) {
+            return true;
+        }
+    }
+}
+
+// Event-driven JSON reader that never builds a document. Objects with a
+// url/uri/href are links; any enclosing object with a title/name is their
+// folder. Chrome writes a folder's name after its children, so links wait in
+// their folder until the name is known.
+class JsonBookmarkParser {
+public:
+    JsonBookmarkParser(QTextStream &in, const LinkSink &sink)
+        : in_(in)
+        , sink_(sink)
+    {
+    }
+
+    bool parse()
+    {
+        QChar c;
+        while (nextToken(&c)) {
+            switch (c.unicode()) {
+            case '{':
+                frames_.append(Frame{true});
+                break;
+            case '[':
+                frames_.append(Frame{false});
+                break;
+            case '}':
+                if (!closeObject()) {
+                    return false;
+                }
+                break;
+            case ']':
+                if (!frames_.isEmpty()) {
+                    frames_.removeLast();
+                }
+                break;
+            case ',':
+                if (!frames_.isEmpty() && frames_.last().isObject) {
+                    frames_.last().expectKey = true;
+                }
+                break;
+            case ':':
+                break;
+            case '"': {
+                const auto value = readString();
+                if (frames_.isEmpty() || !frames_.last().isObject) {
+                    break;
+                }
+                auto &frame = frames_.last();
+                if (frame.expectKey) {
+                    frame.key = value.toLower();
+                    frame.expectKey = false;
+                } else if (!storeField(frame, value)) {
+                    return false;
+                }
+                break;
+            }
+            default:
+                skipLiteral();
+                break;
+            }
+        }
+
+        // Anything still waiting for a folder name goes in uncategorized.
+        while (!frames_.isEmpty()) {
+            const auto frame = frames_.takeLast();
+            for (const auto &link : frame.deferred) {
+                if (!sink_(link)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Frame {
+        bool isObject = false;
+        bool expectKey = true;
+        bool hasName = false;
+        bool hasCategory = false;
+        QString key;
+        QString name;
+        QString url;
+        QString category;
+        QList<LinkItem> deferred;
+    };
+
+    bool storeField(Frame &frame, const QString &value)
+    {
+        if (frame.key == "title" || frame.key == "name") {
+            frame.name = value;
+            frame.hasName = true;
+            for (auto link : std::as_const(frame.deferred)) {
+                link.category = value;
+                if (!sink_(link)) {
+                    return false;
+                }
+            }
+            frame.deferred.clear();
+        } else if (frame.key == "url" || frame.key == "uri" || frame.key == "href") {
+            frame.url = value;
+        } else if (frame.key == "category" || frame.key == "folder") {
+            frame.category = value;
+            frame.hasCategory = true;
+        }
+        return true;
+    }
+
+    bool closeObject()
+    {
+        if (frames_.isEmpty()) {
+            return true;
+        }
+        const auto frame = frames_.takeLast();
+
+        if (!frame.url.isEmpty()) {
+            const LinkItem link{frame.name, frame.category, frame.url};
+            return frame.hasCategory ? sink_(link) : deliver(link);
+        }
+        for (const auto &link : frame.deferred) {
+            if (!deliver(link)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool deliver(LinkItem link)
+    {
+        for (auto it = frames_.rbegin(); it != frames_.rend(); ++it) {
+            if (!it->isObject) {
+                continue;
+            }
+            if (!it->hasName) {
+                it->deferred.append(link);
+                return true;
+            }
+            link.category = it->name;
+            return sink_(link);
+        }
+        return sink_(link);
+    }
+
+    bool fill()
+    {
+        if (position_ < buffer_.size()) {
+            return true;
+        }
+        if (in_.atEnd()) {
+            return false;
+        }
+        buffer_ = in_.read(kReadChunkSize);
+        position_ = 0;
+        return !buffer_.isEmpty();
+    }
+
+    bool next(QChar *c)
+    {
+        if (!fill()) {
+            return false;
+        }
+        *c = buffer_.at(position_++);
+        return true;
+    }
+
+    bool nextToken(QChar *c)
+    {
+        while (next(c)) {
+            if (!c->isSpace()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void skipLiteral()
+    {
+        while (fill()) {
+            const QChar c = buffer_.at(position_);
+            if (c == ',' || c == '}' || c == ']' || c.isSpace()) {
+                return;
+            }
+            ++position_;
+        }
+    }
+
+    QString readString()
+    {
+        QString value;
+        QChar c;
+        while (next(&c)) {
+            if (c == '"') {
+                break;
+            }
+            if (c != '\\') {
+                value += c;
+                continue;
+            }
+            if (!next(&c)) {
+                break;
+            }
+            switch (c.unicode()) {
+            case 'b':
+                value += '\b';
+                break;
+            case 'f':
+                value += '\f';
+                break;
+            case 'n':
+                value += '\n';
+                break;
+            case 'r':
+                value += '\r';
+                break;
+            case 't':
+                value += '\t';
+                break;
+            case 'u': {
+                QString hex;
+                for (int i = 0; i < 4 && next(&c); ++i) {
+                    hex += c;
+                }
+                value += QChar(static_cast<ushort>(hex.toUShort(nullptr, 16)));
+                break;
+            }
+            default:
+                value += c;
+                break;
+            }
+        }
+        return value;
+    }
+
+    QTextStream &in_;
+    const LinkSink &sink_;
+    QString buffer_;
+    int position_ = 0;
+    QList<Frame> frames_;
+};
+}
+
+LinkImporter::Format LinkImporter::detectFormat(const QString &path)
+{
+    const auto suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "html" || suffix == "htm") {
+        return Format::NetscapeHtml;
+    }
+    if (suffix == "json") {
+        return Format::Json;
+    }
+    if (suffix == "csv") {
+        return Format::Csv;
+    }
+
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        const auto head = file.peek(256).trimmed();
+        if (head.startsWith('<')) {
+            return Format::NetscapeHtml;
+        }
+        if (head.startsWith('{') || head.startsWith('[')) {
+            return Format::Json;
+        }
+    }
+    return Format::Csv;
+}
+
+ImportResult LinkImporter::importFile(QSqlDatabase &db, const QString &path, const ProgressCallback &progress)
+{
+    ImportResult result;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.ok = false;
+        result.errorMessage = "Failed to open " + path + ": " + file.errorString();
+        return result;
+    }
+    const qint64 totalBytes = file.size();
+
+    QTextStream in(&file);
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    in.setCodec("UTF-8");
+#endif
+
+    BatchWriter writer(db);
+
+    qint64 accepted = 0;
+    const LinkSink sink = [&](const LinkItem &raw) {
+        LinkItem link{raw.title.trimmed(), raw.category.trimmed(), raw.url.trimmed()};
+        if (link.url.isEmpty()) {
+            ++result.skipped;
+            return true;
+        }
+        if (link.title.isEmpty()) {
+            link.title = link.url;
+        }
+        bool duplicate = false;
+        if (!writer.add(link, &duplicate, &result.errorMessage)) {
+            result.ok = false;
+            return false;
+        }
+        if (duplicate) {
+            ++result.duplicates;
+            return true;
+        }
+
+        ++accepted;
+        if (progress && accepted % kProgressInterval == 0 && !progress(file.pos(), totalBytes, accepted)) {
+            result.cancelled = true;
+            return false;
+        }
+        return true;
+    };
+
+    bool parsed = false;
+    switch (detectFormat(path)) {
+    case Format::NetscapeHtml:
+        parsed = parseNetscapeHtml(in, sink);
+        break;
+    case Format::Csv:
+        parsed = parseCsv(in, sink);
+        break;
+    case Format::Json:
+        parsed = JsonBookmarkParser(in, sink).parse();
+        break;
+    }
+
+    if (!parsed && !result.cancelled) {
+        writer.rollback();
+        result.imported = writer.committed();
+        return result;
+    }
+
+    // A cancelled import keeps the rows read so far.
+    if (!writer.flush(&result.errorMessage)) {
+        result.ok = false;
+    }
+    result.imported = writer.committed();
+    if (progress && result.ok) {
+        progress(totalBytes, totalBytes, result.imported);
+    }
+    return result;
+}
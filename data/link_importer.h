@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+
+#include <QSqlDatabase>
+#include <QString>
+
+#include "../models/link_item.h"
+
+struct ImportResult {
+    bool ok = true;
+    bool cancelled = false;
+    QString errorMessage;
+    qint64 imported = 0;
+    qint64 skipped = 0;
+    // Rows whose URL was already in the database, by LinkUrls::canonical().
+    qint64 duplicates = 0;
+};
+
+// Streams bookmarks from Netscape bookmark HTML, CSV or JSON files into the
+// links table. Files are read incrementally and rows are written through one
+// reused prepared INSERT in large transactions, so memory use does not grow
+// with the file size. Bookmark folders become the link category.
+class LinkImporter {
+public:
+    enum class Format {
+        NetscapeHtml,
+        Csv,
+        Json
+    };
+
+    // Called periodically; return false to cancel. Rows committed so far are kept.
+    using ProgressCallback = std::function<bool(qint64 bytesRead, qint64 totalBytes, qint64 imported)>;
+
+    static Format detectFormat(const QString &path);
+    static ImportResult importFile(QSqlDatabase &db, const QString &path, const ProgressCallback &progress = {});
+
+    static constexpr int kBatchSize = 20000;
+    static constexpr int kProgressInterval = 2000;
+};
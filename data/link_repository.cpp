@@ -0,0 +1,599 @@
+#include "link_repository.h"
+
+#include "link_search.h"
+#include "link_urls.h"
+
+#include <QHash>
+#include <QSqlError>
+#include <QStringList>
+
+#include <utility>
+
+namespace {
+const char *const kStatementSql[] = {
+    // InsertStatement
+    "INSERT INTO links (title, title_sortkey, category_id, url, url_hash) VALUES (?, ?, ?, ?, ?);",
+    // UpdateStatement
+    "UPDATE links SET title = ?, title_sortkey = ?, category_id = ?, url = ?, url_hash = ? WHERE id = ?;",
+    // UpsertStatement
+    "INSERT INTO links (id, title, title_sortkey, category_id, url, url_hash) VALUES (?, ?, ?, ?, ?, ?) "
+    "ON CONFLICT(id) DO UPDATE SET title = excluded.title, title_sortkey = excluded.title_sortkey, "
+    "category_id = excluded.category_id, url = excluded.url, url_hash = excluded.url_hash;",
+    // DeleteStatement
+    "DELETE FROM links WHERE id = ?;",
+    // PruneCategoriesStatement
+    LinkSchema::kPruneCategoriesSql,
+    // GetStatement
+    "SELECT id, title, category, url, title_sortkey FROM links_view WHERE id = ?;",
+    // ListByCategoryStatement
+    "SELECT id, title, category, url, title_sortkey FROM links_view WHERE category = ? ORDER BY title_sortkey;",
+    // ListPageStatement
+    "SELECT id, title, category, url, title_sortkey FROM links_view WHERE id > ? ORDER BY id LIMIT ?;",
+    // ListAllStatement
+    "SELECT id, title, category, url, title_sortkey FROM links_view;",
+    // SearchStatement
+    LinkSearch::kSearchSql,
+    // ChangesSinceStatement
+    "SELECT link_changes.seq, link_changes.link_id, links.id, links.title, categories.name, links.url, "
+    "links.title_sortkey FROM link_changes "
+    "LEFT JOIN links ON links.id = link_changes.link_id "
+    "LEFT JOIN categories ON categories.id = links.category_id "
+    "WHERE link_changes.seq > ? ORDER BY link_changes.seq;",
+    // LatestChangeStatement
+    "SELECT COALESCE(MAX(seq), 0) FROM link_changes;",
+    // DataVersionStatement
+    "PRAGMA data_version;",
+    // FindByUrlHashStatement
+    "SELECT links.id, links.title, categories.name, links.url, links.title_sortkey FROM links "
+    "JOIN categories ON categories.id = links.category_id WHERE links.url_hash = ? ORDER BY links.id;",
+    // DuplicatesStatement
+    "SELECT links.id, links.title, categories.name, links.url, links.title_sortkey, links.url_hash FROM links "
+    "JOIN categories ON categories.id = links.category_id "
+    "WHERE links.url_hash IN (SELECT url_hash FROM links GROUP BY url_hash HAVING COUNT(*) > 1) "
+    "ORDER BY links.url_hash, links.id;",
+    // StaleUrlHashesStatement
+    "SELECT id, url FROM links WHERE url_hash = 0;",
+    // SetUrlHashStatement
+    "UPDATE links SET url_hash = ? WHERE id = ?;",
+    // SaveHealthStatement
+    "INSERT OR REPLACE INTO link_health (link_id, status, latency_ms, checked_at, error) "
+    "SELECT ?, ?, ?, ?, ? WHERE EXISTS (SELECT 1 FROM links WHERE id = ?);",
+    // ListHealthStatement
+    "SELECT link_id, status, latency_ms, checked_at, error FROM link_health;",
+    // HealthTargetsStatement
+    "SELECT links.id, links.url FROM links LEFT JOIN link_health ON link_health.link_id = links.id "
+    "WHERE link_health.checked_at IS NULL OR link_health.checked_at < ? ORDER BY links.id;",
+    // FrecencyStatement
+    "SELECT rank_key, visits FROM link_frecency WHERE link_id = ?;",
+    // SaveFrecencyStatement
+    "INSERT OR REPLACE INTO link_frecency (link_id, rank_key, visits, last_visit) VALUES (?, ?, ?, ?);",
+    // ListFrecencyStatement
+    "SELECT links.id, links.title, categories.name, links.url, links.title_sortkey, link_frecency.rank_key "
+    "FROM link_frecency JOIN links ON links.id = link_frecency.link_id "
+    "JOIN categories ON categories.id = links.category_id;",
+};
+}
+
+LinkRepository::LinkRepository(const QSqlDatabase &db)
+    : db_(db)
+    , categories_(db)
+{
+}
+
+QSqlDatabase LinkRepository::database() const
+{
+    return db_;
+}
+
+bool LinkRepository::insert(const LinkItem &link, qint64 *id, QString *errorMessage)
+{
+    const qint64 categoryId = categories_.idFor(link.category, errorMessage);
+    auto *query = statement(InsertStatement, errorMessage);
+    if (categoryId < 0 || !query) {
+        return false;
+    }
+
+    query->bindValue(0, link.title);
+    query->bindValue(1, LinkSchema::sortKey(link.title));
+    query->bindValue(2, categoryId);
+    query->bindValue(3, link.url);
+    query->bindValue(4, LinkUrls::hash(link.url));
+    if (!exec(query, errorMessage)) {
+        return false;
+    }
+    if (id) {
+        *id = query->lastInsertId().toLongLong();
+    }
+    return true;
+}
+
+bool LinkRepository::update(const LinkRecord &record, QString *errorMessage)
+{
+    const qint64 categoryId = categories_.idFor(record.link.category, errorMessage);
+    auto *query = statement(UpdateStatement, errorMessage);
+    if (categoryId < 0 || !query) {
+        return false;
+    }
+
+    query->bindValue(0, record.link.title);
+    query->bindValue(1, LinkSchema::sortKey(record.link.title));
+    query->bindValue(2, categoryId);
+    query->bindValue(3, record.link.url);
+    query->bindValue(4, LinkUrls::hash(record.link.url));
+    query->bindValue(5, record.id);
+    return exec(query, errorMessage);
+}
+
+bool LinkRepository::remove(qint64 id, QString *errorMessage)
+{
+    auto *query = statement(DeleteStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(0, id);
+    return exec(query, errorMessage);
+}
+
+bool LinkRepository::upsert(const QList<LinkRecord> &records, QList<qint64> *ids, QString *errorMessage)
+{
+    auto *query = statement(UpsertStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+
+    for (const auto &record : records) {
+        if (record.id < 0) {
+            qint64 id = -1;
+            if (!insert(record.link, &id, errorMessage)) {
+                return false;
+            }
+            if (ids) {
+                ids->append(id);
+            }
+            continue;
+        }
+
+        const qint64 categoryId = categories_.idFor(record.link.category, errorMessage);
+        if (categoryId < 0) {
+            return false;
+        }
+        query->bindValue(0, record.id);
+        query->bindValue(1, record.link.title);
+        query->bindValue(2, record.sortKey.isEmpty() ? LinkSchema::sortKey(record.link.title) : record.sortKey);
+        query->bindValue(3, categoryId);
+        query->bindValue(4, record.link.url);
+        query->bindValue(5, LinkUrls::hash(record.link.url));
+        if (!exec(query, errorMessage)) {
+            return false;
+        }
+        if (ids) {
+            ids->append(record.id);
+        }
+    }
+    return true;
+}
+
+bool LinkRepository::pruneCategories(QString *errorMessage)
+{
+    auto *query = statement(PruneCategoriesStatement, errorMessage);
+    if (!query || !exec(query, errorMessage)) {
+        return false;
+    }
+    // Cached ids may point at categories that were just deleted.
+    categories_.clear();
+    return true;
+}
+
+bool LinkRepository::get(qint64 id, LinkRecord *record, QString *errorMessage)
+{
+    auto *query = statement(GetStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(0, id);
+
+    QList<LinkRecord> records;
+    if (!exec(query, errorMessage) || !readRecords(query, &records, errorMessage)) {
+        return false;
+    }
+    if (records.isEmpty()) {
+        errorMessage->clear();
+        return false;
+    }
+    *record = records.first();
+    return true;
+}
+
+bool LinkRepository::listByCategory(const QString &category, QList<LinkRecord> *records, QString *errorMessage)
+{
+    auto *query = statement(ListByCategoryStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(0, category);
+    return exec(query, errorMessage) && readRecords(query, records, errorMessage);
+}
+
+bool LinkRepository::listPage(qint64 afterId, int limit, QList<LinkRecord> *records, QString *errorMessage)
+{
+    auto *query = statement(ListPageStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(0, afterId);
+    query->bindValue(1, limit);
+    return exec(query, errorMessage) && readRecords(query, records, errorMessage);
+}
+
+bool LinkRepository::listAll(QList<LinkRecord> *records, QString *errorMessage)
+{
+    auto *query = statement(ListAllStatement, errorMessage);
+    return query && exec(query, errorMessage) && readRecords(query, records, errorMessage);
+}
+
+bool LinkRepository::search(const QString &expression, int limit, QList<LinkRecord> *records, QString *errorMessage)
+{
+    auto *query = statement(SearchStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(0, expression);
+    query->bindValue(1, limit);
+    return exec(query, errorMessage) && readRecords(query, records, errorMessage);
+}
+
+bool LinkRepository::changesSince(qint64 sequence, LinkChangeSet *changes, qint64 *latest, QString *errorMessage)
+{
+    auto *query = statement(ChangesSinceStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(0, sequence);
+    if (!exec(query, errorMessage)) {
+        return false;
+    }
+
+    *latest = sequence;
+    while (query->next()) {
+        *latest = query->value(0).toLongLong();
+        const qint64 id = query->value(1).toLongLong();
+        if (query->value(2).isNull()) {
+            changes->removed.append(id);
+            continue;
+        }
+        LinkRecord record;
+        record.id = id;
+        record.link.title = query->value(3).toString();
+        record.link.category = query->value(4).toString();
+        record.link.url = query->value(5).toString();
+        record.sortKey = query->value(6).toByteArray();
+        changes->updated.append(record);
+    }
+    query->finish();
+    if (query->lastError().isValid()) {
+        *errorMessage = query->lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool LinkRepository::latestChangeSequence(qint64 *sequence, QString *errorMessage)
+{
+    auto *query = statement(LatestChangeStatement, errorMessage);
+    if (!query || !exec(query, errorMessage)) {
+        return false;
+    }
+    *sequence = query->next() ? query->value(0).toLongLong() : 0;
+    query->finish();
+    return true;
+}
+
+bool LinkRepository::dataVersion(qint64 *version, QString *errorMessage)
+{
+    auto *query = statement(DataVersionStatement, errorMessage);
+    if (!query || !exec(query, errorMessage)) {
+        return false;
+    }
+    *version = query->next() ? query->value(0).toLongLong() : 0;
+    query->finish();
+    return true;
+}
+
+bool LinkRepository::findByUrl(const QString &url, QList<LinkRecord> *records, QString *errorMessage)
+{
+    auto *query = statement(FindByUrlHashStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(0, LinkUrls::hash(url));
+
+    QList<LinkRecord> candidates;
+    if (!exec(query, errorMessage) || !readRecords(query, &candidates, errorMessage)) {
+        return false;
+    }
+    // The hash only narrows the search; equal canonical forms decide.
+    const auto canonical = LinkUrls::canonical(url);
+    for (const auto &candidate : candidates) {
+        if (LinkUrls::canonical(candidate.link.url) == canonical) {
+            records->append(candidate);
+        }
+    }
+    return true;
+}
+
+bool LinkRepository::duplicates(QList<QList<LinkRecord>> *groups, QString *errorMessage)
+{
+    auto *query = statement(DuplicatesStatement, errorMessage);
+    if (!query || !exec(query, errorMessage)) {
+        return false;
+    }
+    QList<LinkRecord> candidates;
+    QList<qint64> hashes;
+    while (query->next()) {
+        LinkRecord record;
+        record.id = query->value(0).toLongLong();
+        record.link.title = query->value(1).toString();
+        record.link.category = query->value(2).toString();
+        record.link.url = query->value(3).toString();
+        record.sortKey = query->value(4).toByteArray();
+        candidates.append(record);
+        hashes.append(query->value(5).toLongLong());
+    }
+    query->finish();
+    if (query->lastError().isValid()) {
+        *errorMessage = query->lastError().text();
+        return false;
+    }
+
+    // Candidates arrive grouped by stored hash; split each run by canonical
+    // form, so a hash collision never merges two different URLs and rows
+    // not hashed yet still find each other.
+    int runStart = 0;
+    while (runStart < candidates.size()) {
+        int runEnd = runStart + 1;
+        while (runEnd < candidates.size() && hashes.at(runEnd) == hashes.at(runStart)) {
+            ++runEnd;
+        }
+
+        QHash<QString, QList<LinkRecord>> byCanonical;
+        QStringList order;
+        for (int i = runStart; i < runEnd; ++i) {
+            const auto canonical = LinkUrls::canonical(candidates.at(i).link.url);
+            auto &group = byCanonical[canonical];
+            if (group.isEmpty()) {
+                order.append(canonical);
+            }
+            group.append(candidates.at(i));
+        }
+        for (const auto &canonical : order) {
+            const auto &group = byCanonical.value(canonical);
+            if (group.size() > 1) {
+                groups->append(group);
+            }
+        }
+        runStart = runEnd;
+    }
+    return true;
+}
+
+bool LinkRepository::refreshUrlHashes(QString *errorMessage)
+{
+    auto *select = statement(StaleUrlHashesStatement, errorMessage);
+    auto *update = statement(SetUrlHashStatement, errorMessage);
+    if (!select || !update || !exec(select, errorMessage)) {
+        return false;
+    }
+    QList<std::pair<qint64, QString>> stale;
+    while (select->next()) {
+        stale.append({select->value(0).toLongLong(), select->value(1).toString()});
+    }
+    select->finish();
+    if (select->lastError().isValid()) {
+        *errorMessage = select->lastError().text();
+        return false;
+    }
+    if (stale.isEmpty()) {
+        return true;
+    }
+
+    if (!db_.transaction()) {
+        *errorMessage = db_.lastError().text();
+        return false;
+    }
+    for (const auto &row : std::as_const(stale)) {
+        update->bindValue(0, LinkUrls::hash(row.second));
+        update->bindValue(1, row.first);
+        if (!exec(update, errorMessage)) {
+            db_.rollback();
+            return false;
+        }
+    }
+    if (!db_.commit()) {
+        *errorMessage = db_.lastError().text();
+        db_.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool LinkRepository::saveHealth(const QList<LinkHealth> &results, QString *errorMessage)
+{
+    auto *query = statement(SaveHealthStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+
+    for (const auto &health : results) {
+        query->bindValue(0, health.linkId);
+        query->bindValue(1, health.httpStatus);
+        query->bindValue(2, health.latencyMs);
+        query->bindValue(3, health.checkedAt);
+        query->bindValue(4, health.error);
+        query->bindValue(5, health.linkId);
+        if (!exec(query, errorMessage)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LinkRepository::listHealth(QList<LinkHealth> *results, QString *errorMessage)
+{
+    auto *query = statement(ListHealthStatement, errorMessage);
+    if (!query || !exec(query, errorMessage)) {
+        return false;
+    }
+
+    while (query->next()) {
+        LinkHealth health;
+        health.linkId = query->value(0).toLongLong();
+        health.httpStatus = query->value(1).toInt();
+        health.latencyMs = query->value(2).toInt();
+        health.checkedAt = query->value(3).toLongLong();
+        health.error = query->value(4).toString();
+        results->append(health);
+    }
+    query->finish();
+    if (query->lastError().isValid()) {
+        *errorMessage = query->lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool LinkRepository::healthTargets(qint64 checkedBefore, QList<LinkRecord> *records, QString *errorMessage)
+{
+    auto *query = statement(HealthTargetsStatement, errorMessage);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(0, checkedBefore);
+    if (!exec(query, errorMessage)) {
+        return false;
+    }
+
+    while (query->next()) {
+        LinkRecord record;
+        record.id = query->value(0).toLongLong();
+        record.link.url = query->value(1).toString();
+        records->append(record);
+    }
+    query->finish();
+    if (query->lastError().isValid()) {
+        *errorMessage = query->lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool LinkRepository::recordVisit(const LinkVisit &visit, LinkFrecency *entry, QString *errorMessage)
+{
+    LinkRecord link;
+    if (!get(visit.linkId, &link, errorMessage)) {
+        return false;
+    }
+
+    auto *current = statement(FrecencyStatement, errorMessage);
+    auto *save = statement(SaveFrecencyStatement, errorMessage);
+    if (!current || !save) {
+        return false;
+    }
+    current->bindValue(0, link.id);
+    if (!exec(current, errorMessage)) {
+        return false;
+    }
+    const bool scored = current->next();
+    const double key = scored ? Frecency::addVisit(current->value(0).toDouble(), visit.visitedAt)
+                              : Frecency::visitKey(visit.visitedAt);
+    const qint64 visits = scored ? current->value(1).toLongLong() + 1 : 1;
+    current->finish();
+
+    save->bindValue(0, link.id);
+    save->bindValue(1, key);
+    save->bindValue(2, visits);
+    save->bindValue(3, visit.visitedAt);
+    if (!exec(save, errorMessage)) {
+        return false;
+    }
+    entry->record = link;
+    entry->rankKey = key;
+    return true;
+}
+
+bool LinkRepository::listFrecency(QList<LinkFrecency> *entries, QString *errorMessage)
+{
+    auto *query = statement(ListFrecencyStatement, errorMessage);
+    if (!query || !exec(query, errorMessage)) {
+        return false;
+    }
+
+    while (query->next()) {
+        LinkFrecency entry;
+        entry.record.id = query->value(0).toLongLong();
+        entry.record.link.title = query->value(1).toString();
+        entry.record.link.category = query->value(2).toString();
+        entry.record.link.url = query->value(3).toString();
+        entry.record.sortKey = query->value(4).toByteArray();
+        entry.rankKey = query->value(5).toDouble();
+        entries->append(entry);
+    }
+    query->finish();
+    if (query->lastError().isValid()) {
+        *errorMessage = query->lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void LinkRepository::discardCaches()
+{
+    categories_.clear();
+}
+
+QSqlQuery *LinkRepository::statement(Statement which, QString *errorMessage)
+{
+    static_assert(sizeof(kStatementSql) / sizeof(kStatementSql[0]) == StatementCount,
+                  "every statement needs an SQL entry");
+    auto &slot = statements_[which];
+    if (slot) {
+        return slot.get();
+    }
+
+    auto query = std::make_unique<QSqlQuery>(db_);
+    query->setForwardOnly(true);
+    if (!query->prepare(QString::fromUtf8(kStatementSql[which]))) {
+        *errorMessage = query->lastError().text();
+        return nullptr;
+    }
+    slot = std::move(query);
+    return slot.get();
+}
+
+bool LinkRepository::exec(QSqlQuery *query, QString *errorMessage)
+{
+    if (!query->exec()) {
+        *errorMessage = query->lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool LinkRepository::readRecords(QSqlQuery *query, QList<LinkRecord> *records, QString *errorMessage)
+{
+    while (query->next()) {
+        LinkRecord record;
+        record.id = query->value(0).toLongLong();
+        record.link.title = query->value(1).toString();
+        record.link.category = query->value(2).toString();
+        record.link.url = query->value(3).toString();
+        record.sortKey = query->value(4).toByteArray();
+        records->append(record);
+    }
+    // Release the read cursor so the statement does not hold a snapshot open.
+    query->finish();
+    if (query->lastError().isValid()) {
+        *errorMessage = query->lastError().text();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include <QList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+
+#include "../models/link_change_set.h"
+#include "../models/link_health.h"
+#include "frecency.h"
+#include "link_schema.h"
+#include "usage_log.h"
+
+// Typed access to the links table on one connection. Every statement is
+// prepared the first time it is used and then reused with fresh bindings,
+// so hot paths never recompile SQL. Use DatabaseManager::repository() to get
+// the instance that belongs to the calling thread's connection.
+//
+// Callers own transactions. After a rollback call discardCaches(), since
+// category ids created inside the transaction are gone.
+class LinkRepository {
+public:
+    explicit LinkRepository(const QSqlDatabase &db);
+
+    QSqlDatabase database() const;
+
+    bool insert(const LinkItem &link, qint64 *id, QString *errorMessage);
+    bool update(const LinkRecord &record, QString *errorMessage);
+    bool remove(qint64 id, QString *errorMessage);
+    // Records with an id < 0 are inserted; the rest are inserted or updated
+    // by id. ids receives the row id of every record, in order.
+    bool upsert(const QList<LinkRecord> &records, QList<qint64> *ids, QString *errorMessage);
+    // Drops categories that no longer have links; run after removes and updates.
+    bool pruneCategories(QString *errorMessage);
+
+    // Returns false with an empty errorMessage when there is no such link.
+    bool get(qint64 id, LinkRecord *record, QString *errorMessage);
+    // Sorted by title sort key.
+    bool listByCategory(const QString &category, QList<LinkRecord> *records, QString *errorMessage);
+    bool listPage(qint64 afterId, int limit, QList<LinkRecord> *records, QString *errorMessage);
+    bool listAll(QList<LinkRecord> *records, QString *errorMessage);
+    // Ranked FTS search; expression comes from LinkSearch::matchExpression().
+    bool search(const QString &expression, int limit, QList<LinkRecord> *records, QString *errorMessage);
+
+    // Links written after sequence, oldest change first. Live rows are
+    // reported as updated, since the log cannot tell an insert from an
+    // update; deleted rows as removed. latest receives the newest sequence
+    // returned, or sequence itself when nothing changed.
+    bool changesSince(qint64 sequence, LinkChangeSet *changes, qint64 *latest, QString *errorMessage);
+    bool latestChangeSequence(qint64 *sequence, QString *errorMessage);
+    // PRAGMA data_version: moves only when another connection commits.
+    bool dataVersion(qint64 *version, QString *errorMessage);
+
+    // Links whose URL has the same LinkUrls::canonical() form, oldest first.
+    bool findByUrl(const QString &url, QList<LinkRecord> *records, QString *errorMessage);
+    // Every set of two or more links sharing a canonical URL, each set
+    // ordered by id.
+    bool duplicates(QList<QList<LinkRecord>> *groups, QString *errorMessage);
+    // Hashes rows whose url_hash is 0: rows inserted by tools that do not
+    // fill the column, and rows whose URL such a tool changed (a trigger
+    // resets their hash). Writes in a transaction of its own, so call it
+    // outside one.
+    bool refreshUrlHashes(QString *errorMessage);
+
+    // Results for links deleted in the meantime are dropped.
+    bool saveHealth(const QList<LinkHealth> &results, QString *errorMessage);
+    bool listHealth(QList<LinkHealth> *results, QString *errorMessage);
+    // Links never checked or last checked before checkedBefore (seconds since
+    // the epoch). Only id and url are filled in.
+    bool healthTargets(qint64 checkedBefore, QList<LinkRecord> *records, QString *errorMessage);
+
+    // Adds one visit to the frecency of link visit.linkId. Returns false
+    // with an empty errorMessage when the link no longer exists.
+    bool recordVisit(const LinkVisit &visit, LinkFrecency *entry, QString *errorMessage);
+    // Every link that has been visited, in no particular order.
+    bool listFrecency(QList<LinkFrecency> *entries, QString *errorMessage);
+
+    void discardCaches();
+
+private:
+    enum Statement {
+        InsertStatement,
+        UpdateStatement,
+        UpsertStatement,
+        DeleteStatement,
+        PruneCategoriesStatement,
+        GetStatement,
+        ListByCategoryStatement,
+        ListPageStatement,
+        ListAllStatement,
+        SearchStatement,
+        ChangesSinceStatement,
+        LatestChangeStatement,
+        DataVersionStatement,
+        FindByUrlHashStatement,
+        DuplicatesStatement,
+        StaleUrlHashesStatement,
+        SetUrlHashStatement,
+        SaveHealthStatement,
+        ListHealthStatement,
+        HealthTargetsStatement,
+        FrecencyStatement,
+        SaveFrecencyStatement,
+        ListFrecencyStatement,
+        StatementCount
+    };
+
+    QSqlQuery *statement(Statement which, QString *errorMessage);
+    bool exec(QSqlQuery *query, QString *errorMessage);
+    bool readRecords(QSqlQuery *query, QList<LinkRecord> *records, QString *errorMessage);
+
+    QSqlDatabase db_;
+    LinkSchema::CategoryResolver categories_;
+    std::array<std::unique_ptr<QSqlQuery>, StatementCount> statements_;
+};
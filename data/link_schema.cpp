@@ -0,0 +1,76 @@
+#include "link_schema.h"
+
+#include <QSqlError>
+#include <QVariant>
+
+namespace LinkSchema {
+    // Run after deletes and updates; categories that lost their last link go away.
+    const char *const kPruneCategoriesSql =
+        "DELETE FROM categories WHERE NOT EXISTS "
+        "(SELECT 1 FROM links WHERE links.category_id = categories.id);";
+
+    QByteArray sortKey(const QString &text)
+    {
+        const auto decomposed = text.normalized(QString::NormalizationForm_KD);
+        QString primary;
+        primary.reserve(decomposed.size());
+        for (const QChar c : decomposed) {
+            if (!c.isMark()) {
+                primary.append(c);
+            }
+        }
+
+        // UTF-8 byte order matches code point order, so memcmp sorts the folded text.
+        QByteArray key = primary.toCaseFolded().toUtf8();
+        key.append('\0');
+        key.append(text.toUtf8());
+        return key;
+    }
+
+    CategoryResolver::CategoryResolver(const QSqlDatabase &db)
+        : insert_(db)
+        , select_(db)
+    {
+    }
+
+    qint64 CategoryResolver::idFor(const QString &name, QString *errorMessage)
+    {
+        const auto cached = ids_.constFind(name);
+        if (cached != ids_.cend()) {
+            return *cached;
+        }
+
+        if (!prepared_) {
+            if (!insert_.prepare("INSERT OR IGNORE INTO categories (name, sort_key) VALUES (?, ?);")
+                || !select_.prepare("SELECT id FROM categories WHERE name = ?;")) {
+                *errorMessage = insert_.lastError().isValid() ? insert_.lastError().text() : select_.lastError().text();
+                return -1;
+            }
+            prepared_ = true;
+        }
+
+        insert_.bindValue(0, name);
+        insert_.bindValue(1, sortKey(name));
+        if (!insert_.exec()) {
+            *errorMessage = insert_.lastError().text();
+            return -1;
+        }
+
+        select_.bindValue(0, name);
+        if (!select_.exec() || !select_.next()) {
+            *errorMessage = select_.lastError().isValid() ? select_.lastError().text()
+                                                          : "Failed to resolve category " + name + ".";
+            return -1;
+        }
+        const qint64 id = select_.value(0).toLongLong();
+        select_.finish();
+
+        ids_.insert(name, id);
+        return id;
+    }
+
+    void CategoryResolver::clear()
+    {
+        ids_.clear();
+    }
+} // namespace LinkSchema
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+
+// Shared pieces of the normalized (v3) links schema. Links reference a row in
+// categories by id and both tables carry a precomputed sort key. Reads go
+// through links_view, which joins the name back in as "category" and also
+// exposes category_id, category_sortkey and title_sortkey.
+namespace LinkSchema {
+extern const char *const kPruneCategoriesSql;
+
+// Byte-comparable collation key: accents and case are ignored first, like a
+// collator at primary strength, and the exact text breaks ties so distinct
+// strings never compare equal. Keys are stored in the database, so changing
+// this needs a migration that recomputes them.
+QByteArray sortKey(const QString &text);
+
+// Maps category names to ids, creating categories on first use. Ids are
+// cached, so keep one resolver per transaction and clear() it on rollback.
+class CategoryResolver {
+public:
+    explicit CategoryResolver(const QSqlDatabase &db);
+
+    qint64 idFor(const QString &name, QString *errorMessage);
+    void clear();
+
+private:
+    QSqlQuery insert_;
+    QSqlQuery select_;
+    bool prepared_ = false;
+    QHash<QString, qint64> ids_;
+};
+}
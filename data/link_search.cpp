@@ -0,0 +1,20 @@
+#include "link_search.h"
+
+#include <QRegularExpression>
+#include <QStringList>
+
+namespace LinkSearch {
+    QString matchExpression(const QString &text) {
+        static const QRegularExpression whitespace("\\s+");
+        const auto words = text.split(whitespace, Qt::SkipEmptyParts);
+
+        QStringList terms;
+        terms.reserve(words.size());
+        for (auto word : words) {
+            // Quoting keeps FTS5 operators and punctuation in user input literal.
+            word.replace('"', "\"\"");
+            terms.append(QString("\"") + word + "\"*");
+        }
+        return terms.join(' ');
+    }
+} // namespace LinkSearch
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QString>
+
+namespace LinkSearch {
+// Ranked prefix search over the links_fts index. Binds a MATCH expression and a row limit.
+constexpr const char *kSearchSql = R"SQL(
+SELECT links_view.id, links_view.title, links_view.category, links_view.url, links_view.title_sortkey
+FROM links_fts
+JOIN links_view ON links_view.id = links_fts.rowid
+WHERE links_fts MATCH ?
+ORDER BY bm25(links_fts, 10.0, 4.0, 1.0), links_view.title_sortkey
+LIMIT ?;
+)SQL";
+
+// Turns free text into an FTS5 MATCH expression where every word must match
+// as a prefix. Returns an empty string when there is nothing to search for.
+QString matchExpression(const QString &text);
+}
@@ -0,0 +1,247 @@
+#include "link_table_query.h"
+
+#include "link_schema.h"
+
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Rows between two polls of cancelled().
+constexpr int kPollRows = 4096;
+// Rows are sorted in chunks of this size that are then merged pairwise, so
+// a cancelled sort stops after one pass instead of finishing.
+constexpr int kSortChunk = 16384;
+const char kSchemeSeparator[] = "://";
+
+char asciiLower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// needle must already be lowercase.
+bool containsIgnoringCase(const QByteArray &haystack, const QByteArray &needle)
+{
+    return std::search(haystack.cbegin(), haystack.cend(), needle.cbegin(), needle.cend(),
+                       [](char left, char right) { return asciiLower(left) == right; })
+        != haystack.cend();
+}
+
+// The case-folded half of a LinkSchema::sortKey(), which ends at '\0'.
+QByteArray foldedText(const QByteArray &sortKey)
+{
+    const int end = static_cast<int>(sortKey.indexOf('\0'));
+    return end < 0 ? sortKey : QByteArray::fromRawData(sortKey.constData(), end);
+}
+
+// Works on the stored text without parsing it as a QUrl: the host runs
+// from after "://" (or the start, for text without a scheme) to the first
+// '/', '?' or '#', minus user info and port. host must be lowercase.
+bool hostMatches(const QByteArray &url, const QByteArray &host)
+{
+    const char *begin = url.constData();
+    const char *end = begin + url.size();
+    const char *scheme = std::search(begin, end, kSchemeSeparator, kSchemeSeparator + 3);
+    const char *start = scheme == end ? begin : scheme + 3;
+    const char *stop = std::find_if(start, end, [](char c) { return c == '/' || c == '?' || c == '#'; });
+
+    for (const char *c = stop; c != start; --c) {
+        if (*(c - 1) == '@') {
+            start = c;
+            break;
+        }
+    }
+    if (start != stop && *start == '[') {
+        // IPv6 literals keep their colons.
+        const char *close = std::find(start, stop, ']');
+        stop = close == stop ? stop : close + 1;
+    } else {
+        stop = std::find(start, stop, ':');
+    }
+
+    const auto length = stop - start;
+    if (length < host.size()) {
+        return false;
+    }
+    const char *suffix = stop - host.size();
+    if (length > host.size() && *(suffix - 1) != '.') {
+        return false;
+    }
+    return std::equal(suffix, stop, host.cbegin(), [](char left, char right) { return asciiLower(left) == right; });
+}
+
+template <typename Less>
+bool sortRows(QVector<int> *rows, Less less, const std::function<bool()> &cancelled)
+{
+    const int count = static_cast<int>(rows->size());
+    const auto begin = rows->begin();
+    for (int first = 0; first < count; first += kSortChunk) {
+        std::sort(begin + first, begin + std::min(first + kSortChunk, count), less);
+        if (cancelled()) {
+            return false;
+        }
+    }
+    for (int width = kSortChunk; width < count; width *= 2) {
+        for (int first = 0; first + width < count; first += 2 * width) {
+            std::inplace_merge(begin + first, begin + first + width, begin + std::min(first + 2 * width, count),
+                               less);
+        }
+        if (cancelled()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Position of each category id when categories are ordered by sort key.
+QVector<int> categoryRanks(const CategoryPool &categories)
+{
+    QVector<std::pair<QByteArray, int>> keys;
+    keys.reserve(categories.size());
+    for (int id = 0; id < categories.size(); ++id) {
+        keys.append({LinkSchema::sortKey(categories.name(static_cast<quint32>(id))), id});
+    }
+    std::sort(keys.begin(), keys.end());
+
+    QVector<int> ranks(categories.size());
+    for (int rank = 0; rank < keys.size(); ++rank) {
+        ranks[keys.at(rank).second] = rank;
+    }
+    return ranks;
+}
+}
+
+bool LinkTableFilter::isEmpty() const
+{
+    return text.isEmpty() && category.isEmpty() && host.isEmpty();
+}
+
+bool LinkTableFilter::operator==(const LinkTableFilter &other) const
+{
+    return text == other.text && category == other.category && host == other.host;
+}
+
+bool LinkTableFilter::operator!=(const LinkTableFilter &other) const
+{
+    return !(*this == other);
+}
+
+bool LinkTableQuery::isIdentity() const
+{
+    return filter.isEmpty() && sortKeys.isEmpty();
+}
+
+namespace LinkTable {
+    LinkTableFilter parseFilter(const QString &text)
+    {
+        static const QRegularExpression term(R"((?:(category|host):)?(?:"([^"]*)"?|(\S+)))",
+                                             QRegularExpression::CaseInsensitiveOption);
+        LinkTableFilter filter;
+        QStringList words;
+        auto matches = term.globalMatch(text);
+        while (matches.hasNext()) {
+            const auto match = matches.next();
+            const auto value = (match.capturedStart(2) >= 0 ? match.captured(2) : match.captured(3)).trimmed();
+            const auto field = match.captured(1).toLower();
+            if (field == "category") {
+                filter.category = value;
+            } else if (field == "host") {
+                filter.host = value;
+            } else if (!value.isEmpty()) {
+                words.append(value);
+            }
+        }
+        filter.text = words.join(' ');
+        return filter;
+    }
+
+    bool evaluate(const LinkColumns &columns, const LinkTableQuery &query, const std::function<bool()> &cancelled,
+                  QVector<int> *rows)
+    {
+        const auto &filter = query.filter;
+        const auto &strings = columns.strings;
+        const int count = columns.rowCount();
+
+        // Titles are matched on their stored sort keys, so the needle is
+        // folded the same way once instead of every title being folded.
+        QByteArray titleNeedle;
+        QByteArray urlNeedle;
+        if (!filter.text.isEmpty()) {
+            const auto key = LinkSchema::sortKey(filter.text);
+            titleNeedle = key.left(key.indexOf('\0'));
+            urlNeedle = filter.text.toLower().toUtf8();
+        }
+        const QByteArray host = filter.host.toLower().toUtf8();
+        const bool byCategory = !filter.category.isEmpty();
+        QVector<bool> categoryMatches;
+        if (byCategory) {
+            categoryMatches.resize(columns.categories.size());
+            for (int id = 0; id < columns.categories.size(); ++id) {
+                categoryMatches[id] =
+                    columns.categories.name(static_cast<quint32>(id)).compare(filter.category, Qt::CaseInsensitive)
+                    == 0;
+            }
+        }
+
+        QVector<int> matched;
+        matched.reserve(count);
+        for (int row = 0; row < count; ++row) {
+            if (row % kPollRows == 0 && cancelled()) {
+                return false;
+            }
+            if (byCategory && !categoryMatches.value(static_cast<int>(columns.categoryIds.at(row)), false)) {
+                continue;
+            }
+            if (!host.isEmpty() && !hostMatches(strings.bytes(columns.urls.at(row)), host)) {
+                continue;
+            }
+            if (!urlNeedle.isEmpty()) {
+                const bool titleMatch = !titleNeedle.isEmpty()
+                    && foldedText(strings.bytes(columns.sortKeys.at(row))).contains(titleNeedle);
+                if (!titleMatch && !containsIgnoringCase(strings.bytes(columns.urls.at(row)), urlNeedle)) {
+                    continue;
+                }
+            }
+            matched.append(row);
+        }
+
+        if (!query.sortKeys.isEmpty()) {
+            const bool byCategoryRank = std::any_of(query.sortKeys.cbegin(), query.sortKeys.cend(),
+                                                    [](const LinkTableSortKey &key) {
+                                                        return key.column == LinkColumns::CategoryColumn;
+                                                    });
+            const auto ranks = byCategoryRank ? categoryRanks(columns.categories) : QVector<int>();
+            const auto less = [&](int left, int right) {
+                for (const auto &key : query.sortKeys) {
+                    int order = 0;
+                    switch (key.column) {
+                    case LinkColumns::TitleColumn:
+                        order = strings.compare(columns.sortKeys.at(left), columns.sortKeys.at(right));
+                        break;
+                    case LinkColumns::CategoryColumn:
+                        order = ranks.at(static_cast<int>(columns.categoryIds.at(left)))
+                            - ranks.at(static_cast<int>(columns.categoryIds.at(right)));
+                        break;
+                    case LinkColumns::UrlColumn:
+                        order = strings.compare(columns.urls.at(left), columns.urls.at(right));
+                        break;
+                    default:
+                        break;
+                    }
+                    if (order != 0) {
+                        return key.order == Qt::AscendingOrder ? order < 0 : order > 0;
+                    }
+                }
+                return left < right;
+            };
+            if (!sortRows(&matched, less, cancelled)) {
+                return false;
+            }
+        }
+
+        *rows = std::move(matched);
+        return true;
+    }
+} // namespace LinkTable
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <Qt>
+
+#include <functional>
+
+#include "../models/link_columns.h"
+
+// Predicates of the link table's filter box. Empty fields match every row.
+struct LinkTableFilter {
+    // Substring of the title, ignoring case and accents, or of the URL,
+    // ignoring ASCII case.
+    QString text;
+    // Category name, ignoring case.
+    QString category;
+    // URL host; its subdomains match too.
+    QString host;
+
+    bool isEmpty() const;
+    bool operator==(const LinkTableFilter &other) const;
+    bool operator!=(const LinkTableFilter &other) const;
+};
+
+struct LinkTableSortKey {
+    // A LinkColumns::Column.
+    int column = LinkColumns::TitleColumn;
+    Qt::SortOrder order = Qt::AscendingOrder;
+};
+
+struct LinkTableQuery {
+    LinkTableFilter filter;
+    // Most significant first; ties fall back to model order.
+    QList<LinkTableSortKey> sortKeys;
+
+    // True when every row shows in model order.
+    bool isIdentity() const;
+};
+
+namespace LinkTable {
+// Reads "category:<name>" and "host:<name>" terms, quoting names that hold
+// spaces (category:"Read later"); the other words, joined by single spaces,
+// become the text predicate.
+LinkTableFilter parseFilter(const QString &text);
+
+// Model rows that pass the filter, in sort order. Meant for a worker thread:
+// cancelled() is polled every few thousand rows and between sort passes,
+// and evaluation stops with false, leaving rows untouched, once it returns
+// true.
+bool evaluate(const LinkColumns &columns, const LinkTableQuery &query, const std::function<bool()> &cancelled,
+              QVector<int> *rows);
+}
@@ -0,0 +1,87 @@
+#include "link_urls.h"
+
+#include <QStringList>
+#include <QUrl>
+
+namespace LinkUrls {
+    namespace {
+        bool isTrackingParameter(const QString &key)
+        {
+            static const char *const kTrackingKeys[] = {
+                "fbclid", "gclid", "dclid", "msclkid", "yclid", "igshid", "mc_cid", "mc_eid", "_ga", "_hsenc",
+                "_hsmi",
+            };
+            if (key.startsWith("utm_", Qt::CaseInsensitive)) {
+                return true;
+            }
+            for (const auto *tracking : kTrackingKeys) {
+                if (key.compare(QLatin1String(tracking), Qt::CaseInsensitive) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        int defaultPort(const QString &scheme)
+        {
+            if (scheme == "http") {
+                return 80;
+            }
+            if (scheme == "https") {
+                return 443;
+            }
+            if (scheme == "ftp") {
+                return 21;
+            }
+            return -1;
+        }
+    }
+
+    QString canonical(const QString &url)
+    {
+        const auto trimmed = url.trimmed();
+        QUrl parsed = QUrl::fromUserInput(trimmed);
+        if (!parsed.isValid() || parsed.scheme().isEmpty()) {
+            return trimmed;
+        }
+
+        // QUrl already lowercases the scheme and the host.
+        if (parsed.port() == defaultPort(parsed.scheme())) {
+            parsed.setPort(-1);
+        }
+
+        auto path = parsed.path(QUrl::FullyEncoded);
+        while (path.endsWith('/')) {
+            path.chop(1);
+        }
+        parsed.setPath(path, QUrl::TolerantMode);
+
+        if (parsed.hasQuery()) {
+            // Filtered on the encoded text so kept parameters stay byte-identical.
+            QStringList kept;
+            const auto items = parsed.query(QUrl::FullyEncoded).split('&', Qt::SkipEmptyParts);
+            for (const auto &item : items) {
+                if (!isTrackingParameter(item.section('=', 0, 0))) {
+                    kept.append(item);
+                }
+            }
+            parsed.setQuery(kept.isEmpty() ? QString() : kept.join('&'));
+        }
+        if (parsed.hasFragment() && parsed.fragment().isEmpty()) {
+            parsed.setFragment(QString());
+        }
+
+        return QString::fromLatin1(parsed.toEncoded(QUrl::FullyEncoded));
+    }
+
+    qint64 hash(const QString &url)
+    {
+        const auto bytes = canonical(url).toUtf8();
+        quint64 value = 14695981039346656037ULL;
+        for (const char byte : bytes) {
+            value ^= static_cast<uchar>(byte);
+            value *= 1099511628211ULL;
+        }
+        return value == 0 ? 1 : static_cast<qint64>(value);
+    }
+} // namespace LinkUrls
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QString>
+
+// Canonical URL forms used to spot links that point at the same page.
+// Hashes are stored in links.url_hash, so changing either function needs a
+// migration that recomputes them.
+namespace LinkUrls {
+// Parses with QUrl::fromUserInput(), which also lowercases scheme and host,
+// then drops default ports, trailing slashes, known tracking parameters
+// (utm_*, fbclid, gclid, ...) and a bare '?' or '#'. Text that does not
+// parse as a URL is returned trimmed.
+QString canonical(const QString &url);
+
+// 64-bit FNV-1a of the canonical form. Never 0, which marks rows written by
+// tools that do not fill the column; see LinkRepository::refreshUrlHashes().
+qint64 hash(const QString &url);
+}
@@ -0,0 +1,72 @@
+#include "storage_profile.h"
+
+namespace {
+const char *kWalJournalKey = "storage/walJournal";
+const char *kMmapSizeKey = "storage/mmapSizeMiB";
+const char *kCacheSizeKey = "storage/cacheSizeMiB";
+const char *kSynchronousKey = "storage/synchronous";
+const char *kMemoryTempStoreKey = "storage/memoryTempStore";
+const char *kMaintenanceIntervalKey = "storage/maintenanceIntervalMinutes";
+
+const char *synchronousName(StorageProfile::Synchronous mode)
+{
+    switch (mode) {
+    case StorageProfile::Synchronous::Off:
+        return "OFF";
+    case StorageProfile::Synchronous::Normal:
+        return "NORMAL";
+    case StorageProfile::Synchronous::Full:
+        return "FULL";
+    }
+    return "FULL";
+}
+}
+
+StorageProfile StorageProfile::sqliteDefaults()
+{
+    StorageProfile profile;
+    profile.walJournal = false;
+    profile.mmapSizeMiB = 0;
+    profile.cacheSizeMiB = 2;
+    profile.synchronous = Synchronous::Full;
+    profile.memoryTempStore = false;
+    profile.maintenanceIntervalMinutes = 0;
+    return profile;
+}
+
+StorageProfile StorageProfile::load(const QSettings &settings)
+{
+    const StorageProfile defaults;
+    StorageProfile profile;
+    profile.walJournal = settings.value(kWalJournalKey, defaults.walJournal).toBool();
+    profile.mmapSizeMiB = qMax(0, settings.value(kMmapSizeKey, defaults.mmapSizeMiB).toInt());
+    profile.cacheSizeMiB = qMax(1, settings.value(kCacheSizeKey, defaults.cacheSizeMiB).toInt());
+    const int synchronous = settings.value(kSynchronousKey, static_cast<int>(defaults.synchronous)).toInt();
+    profile.synchronous = static_cast<Synchronous>(qBound(0, synchronous, static_cast<int>(Synchronous::Full)));
+    profile.memoryTempStore = settings.value(kMemoryTempStoreKey, defaults.memoryTempStore).toBool();
+    profile.maintenanceIntervalMinutes =
+        qMax(0, settings.value(kMaintenanceIntervalKey, defaults.maintenanceIntervalMinutes).toInt());
+    return profile;
+}
+
+void StorageProfile::save(QSettings &settings) const
+{
+    settings.setValue(kWalJournalKey, walJournal);
+    settings.setValue(kMmapSizeKey, mmapSizeMiB);
+    settings.setValue(kCacheSizeKey, cacheSizeMiB);
+    settings.setValue(kSynchronousKey, static_cast<int>(synchronous));
+    settings.setValue(kMemoryTempStoreKey, memoryTempStore);
+    settings.setValue(kMaintenanceIntervalKey, maintenanceIntervalMinutes);
+}
+
+QStringList StorageProfile::pragmas() const
+{
+    return {
+        QString("PRAGMA journal_mode = %1;").arg(walJournal ? "WAL" : "DELETE"),
+        QString("PRAGMA synchronous = %1;").arg(synchronousName(synchronous)),
+        // A negative cache_size is in KiB rather than pages.
+        QString("PRAGMA cache_size = -%1;").arg(qint64(cacheSizeMiB) * 1024),
+        QString("PRAGMA mmap_size = %1;").arg(qint64(mmapSizeMiB) * 1024 * 1024),
+        QString("PRAGMA temp_store = %1;").arg(memoryTempStore ? "MEMORY" : "DEFAULT"),
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QSettings>
+#include <QStringList>
+
+// SQLite tuning applied to every connection when it opens. The defaults suit
+// a desktop app with a single writer: WAL so readers never wait on a save,
+// synchronous=NORMAL (safe across application crashes; a power loss can drop
+// the last commit), a large page cache and a memory-mapped read window.
+struct StorageProfile {
+    enum class Synchronous {
+        Off,
+        Normal,
+        Full
+    };
+
+    bool walJournal = true;
+    int mmapSizeMiB = 256;
+    int cacheSizeMiB = 64;
+    Synchronous synchronous = Synchronous::Normal;
+    bool memoryTempStore = true;
+    // How often to run wal_checkpoint(PASSIVE) and PRAGMA optimize; 0 disables.
+    int maintenanceIntervalMinutes = 10;
+
+    // What SQLite does when left alone; the baseline in benchmarks.
+    static StorageProfile sqliteDefaults();
+    static StorageProfile load(const QSettings &settings);
+    void save(QSettings &settings) const;
+
+    // Statements for a freshly opened connection, run outside any transaction.
+    QStringList pragmas() const;
+};
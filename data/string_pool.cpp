@@ -0,0 +1,94 @@
+#include "string_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+quint32 CategoryPool::intern(const QString &name)
+{
+    const auto existing = ids_.constFind(name);
+    if (existing != ids_.cend()) {
+        return *existing;
+    }
+
+    const auto id = static_cast<quint32>(names_.size());
+    names_.append(name);
+    ids_.insert(name, id);
+    return id;
+}
+
+const QString &CategoryPool::name(quint32 id) const
+{
+    static const QString kEmpty;
+    return id < static_cast<quint32>(names_.size()) ? names_.at(static_cast<int>(id)) : kEmpty;
+}
+
+int CategoryPool::size() const
+{
+    return static_cast<int>(names_.size());
+}
+
+void CategoryPool::clear()
+{
+    ids_.clear();
+    names_.clear();
+}
+
+StringArena::Ref StringArena::add(const QString &text)
+{
+    return add(text.toUtf8());
+}
+
+StringArena::Ref StringArena::add(const QByteArray &bytes)
+{
+    Ref ref;
+    ref.offset = static_cast<quint32>(data_.size());
+    ref.length = static_cast<quint32>(bytes.size());
+    data_.append(bytes);
+    return ref;
+}
+
+QString StringArena::text(Ref ref) const
+{
+    return QString::fromUtf8(data_.constData() + ref.offset, static_cast<int>(ref.length));
+}
+
+QByteArray StringArena::bytes(Ref ref) const
+{
+    return QByteArray::fromRawData(data_.constData() + ref.offset, static_cast<int>(ref.length));
+}
+
+int StringArena::compare(Ref left, Ref right) const
+{
+    const int order = std::memcmp(data_.constData() + left.offset, data_.constData() + right.offset,
+                                  std::min(left.length, right.length));
+    if (order != 0) {
+        return order;
+    }
+    return left.length < right.length ? -1 : (left.length > right.length ? 1 : 0);
+}
+
+void StringArena::release(Ref ref)
+{
+    released_ += ref.length;
+}
+
+bool StringArena::needsCompaction() const
+{
+    return released_ >= kMinCompactionBytes && released_ * 2 > data_.size();
+}
+
+int StringArena::byteCount() const
+{
+    return static_cast<int>(data_.size());
+}
+
+void StringArena::reserve(int bytes)
+{
+    data_.reserve(bytes);
+}
+
+void StringArena::clear()
+{
+    data_.clear();
+    released_ = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Category names interned to dense 32-bit ids. A few hundred categories are
+// shared by every link, so rows hold an id instead of their own copy of the
+// name, and the id doubles as a bucket index when grouping. Ids are never
+// reused; clear() drops them all.
+class CategoryPool {
+public:
+    quint32 intern(const QString &name);
+    // Empty for an id that was never handed out.
+    const QString &name(quint32 id) const;
+    int size() const;
+    void clear();
+
+private:
+    QHash<QString, quint32> ids_;
+    QVector<QString> names_;
+};
+
+// Append-only UTF-8 storage for many short strings, such as link titles and
+// URLs. Each string costs its UTF-8 bytes plus an 8-byte Ref, instead of a
+// UTF-16 QString with its own allocation. Released strings stay in place
+// until the owner copies the live ones into a fresh arena; see
+// needsCompaction().
+class StringArena {
+public:
+    struct Ref {
+        quint32 offset = 0;
+        quint32 length = 0;
+    };
+
+    Ref add(const QString &text);
+    Ref add(const QByteArray &bytes);
+    QString text(Ref ref) const;
+    // Points into the arena without copying; valid until the arena changes.
+    QByteArray bytes(Ref ref) const;
+    // Byte-wise, like QByteArray::compare().
+    int compare(Ref left, Ref right) const;
+
+    // Counts the string as garbage for needsCompaction().
+    void release(Ref ref);
+    // True once most of the arena is released strings.
+    bool needsCompaction() const;
+    int byteCount() const;
+    void reserve(int bytes);
+    void clear();
+
+private:
+    QByteArray data_;
+    qint64 released_ = 0;
+
+    static constexpr qint64 kMinCompactionBytes = 64 * 1024;
+};
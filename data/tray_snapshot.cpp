@@ -0,0 +1,281 @@
+#include "tray_snapshot.h"
+
+#include <cstring>
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+namespace {
+const char kMagic[4] = {'L', 'D', 'T', 'S'};
+constexpr qint64 kHeaderSize = 6 * 4;
+constexpr qint64 kGroupRecordSize = 6 * 4;
+constexpr qint64 kEntryRecordSize = 8 + 6 * 4;
+// The file change counter lives at byte 24 of the 100-byte SQLite header.
+constexpr int kChangeCounterOffset = 24;
+
+quint32 readUInt32(const uchar *data, int field)
+{
+    return qFromLittleEndian<quint32>(data + field * 4);
+}
+
+void appendUInt32(QByteArray &out, quint32 value)
+{
+    const auto little = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char *>(&little), sizeof(little));
+}
+
+void appendInt64(QByteArray &out, qint64 value)
+{
+    const auto little = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char *>(&little), sizeof(little));
+}
+
+// Appends bytes to the string blob and writes their offset/length pair.
+void appendString(QByteArray &table, QByteArray &strings, const QByteArray &bytes)
+{
+    appendUInt32(table, static_cast<quint32>(strings.size()));
+    appendUInt32(table, static_cast<quint32>(bytes.size()));
+    strings.append(bytes);
+}
+}
+
+TraySnapshot::~TraySnapshot()
+{
+    close();
+}
+
+QString TraySnapshot::pathFor(const QString &databasePath)
+{
+    return databasePath + ".tray";
+}
+
+QByteArray TraySnapshot::databaseStamp(const QString &databasePath)
+{
+    const QFileInfo database(databasePath);
+    if (!database.exists()) {
+        return {};
+    }
+
+    quint32 changeCounter = 0;
+    QFile file(databasePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        const auto header = file.read(kChangeCounterOffset + 4);
+        if (header.size() == kChangeCounterOffset + 4) {
+            changeCounter = qFromBigEndian<quint32>(header.constData() + kChangeCounterOffset);
+        }
+    }
+
+    auto stamp = QString("%1:%2:%3")
+                     .arg(database.size())
+                     .arg(database.lastModified().toMSecsSinceEpoch())
+                     .arg(changeCounter);
+    // In WAL mode commits land in the -wal file and the header counter may
+    // not move until a checkpoint, so the WAL file is part of the stamp.
+    const QFileInfo wal(databasePath + "-wal");
+    if (wal.exists() && wal.size() > 0) {
+        stamp += QString(":%1:%2").arg(wal.size()).arg(wal.lastModified().toMSecsSinceEpoch());
+    }
+    return stamp.toUtf8();
+}
+
+bool TraySnapshot::write(const QString &path, const LinkGroups &groups, const QByteArray &stamp,
+                         QString *errorMessage)
+{
+    QByteArray groupTable;
+    QByteArray entryTable;
+    QByteArray strings = stamp;
+    groupTable.reserve(groups.groups().size() * kGroupRecordSize);
+    entryTable.reserve(groups.linkCount() * kEntryRecordSize);
+
+    quint32 entryCount = 0;
+    for (auto it = groups.groups().cbegin(); it != groups.groups().cend(); ++it) {
+        appendString(groupTable, strings, it->category.toUtf8());
+        appendString(groupTable, strings, it.key());
+        appendUInt32(groupTable, entryCount);
+        appendUInt32(groupTable, static_cast<quint32>(it->entries.size()));
+
+        // Entries are UTF-8 in the groups' arena already.
+        const auto &arena = groups.strings();
+        for (const auto &entry : it->entries) {
+            appendInt64(entryTable, entry.id);
+            appendString(entryTable, strings, arena.bytes(entry.title));
+            appendString(entryTable, strings, arena.bytes(entry.url));
+            appendString(entryTable, strings, arena.bytes(entry.sortKey));
+        }
+        entryCount += static_cast<quint32>(it->entries.size());
+    }
+
+    QByteArray header(kMagic, sizeof(kMagic));
+    appendUInt32(header, kVersion);
+    appendUInt32(header, static_cast<quint32>(groups.groups().size()));
+    appendUInt32(header, entryCount);
+    appendUInt32(header, static_cast<quint32>(strings.size()));
+    appendUInt32(header, static_cast<quint32>(stamp.size()));
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+    if (file.write(header) != header.size() || file.write(groupTable) != groupTable.size()
+        || file.write(entryTable) != entryTable.size() || file.write(strings) != strings.size()) {
+        *errorMessage = file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TraySnapshot::open(const QString &path, QString *errorMessage)
+{
+    close();
+    errorMessage->clear();
+
+    file_.setFileName(path);
+    if (!file_.exists()) {
+        return false;
+    }
+    if (!file_.open(QIODevice::ReadOnly)) {
+        *errorMessage = file_.errorString();
+        return false;
+    }
+
+    const qint64 size = file_.size();
+    const uchar *data = size >= kHeaderSize ? file_.map(0, size) : nullptr;
+    if (!data || memcmp(data, kMagic, sizeof(kMagic)) != 0 || readUInt32(data, 1) != kVersion) {
+        *errorMessage = QString("%1 is not a tray snapshot of this version.").arg(path);
+        close();
+        return false;
+    }
+
+    const quint32 groupCount = readUInt32(data, 2);
+    const quint32 entryCount = readUInt32(data, 3);
+    const quint32 stringsSize = readUInt32(data, 4);
+    const quint32 stampLength = readUInt32(data, 5);
+    const qint64 expectedSize = kHeaderSize + groupCount * kGroupRecordSize + entryCount * kEntryRecordSize
+        + stringsSize;
+    if (expectedSize != size || stampLength > stringsSize) {
+        *errorMessage = QString("%1 is truncated or corrupt.").arg(path);
+        close();
+        return false;
+    }
+
+    data_ = data;
+    groups_ = data + kHeaderSize;
+    entries_ = groups_ + groupCount * kGroupRecordSize;
+    strings_ = entries_ + entryCount * kEntryRecordSize;
+    groupCount_ = groupCount;
+    entryCount_ = entryCount;
+    stringsSize_ = stringsSize;
+    stampLength_ = stampLength;
+
+    // Entry ranges are checked once here; string ranges on every read.
+    for (int group = 0; group < static_cast<int>(groupCount); ++group) {
+        const auto *record = groupRecord(group);
+        if (static_cast<quint64>(readUInt32(record, 4)) + readUInt32(record, 5) > entryCount) {
+            *errorMessage = QString("%1 is truncated or corrupt.").arg(path);
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TraySnapshot::isOpen() const
+{
+    return data_ != nullptr;
+}
+
+QByteArray TraySnapshot::stamp() const
+{
+    return bytes(0, stampLength_);
+}
+
+int TraySnapshot::groupCount() const
+{
+    return static_cast<int>(groupCount_);
+}
+
+int TraySnapshot::linkCount() const
+{
+    return static_cast<int>(entryCount_);
+}
+
+QString TraySnapshot::category(int group) const
+{
+    const auto *record = groupRecord(group);
+    return record ? QString::fromUtf8(bytes(readUInt32(record, 0), readUInt32(record, 1))) : QString();
+}
+
+QByteArray TraySnapshot::groupKey(int group) const
+{
+    const auto *record = groupRecord(group);
+    return record ? bytes(readUInt32(record, 2), readUInt32(record, 3)) : QByteArray();
+}
+
+int TraySnapshot::entryCount(int group) const
+{
+    const auto *record = groupRecord(group);
+    return record ? static_cast<int>(readUInt32(record, 5)) : 0;
+}
+
+TraySnapshot::Entry TraySnapshot::entry(int group, int index) const
+{
+    Entry entry;
+    const auto *record = groupRecord(group);
+    if (!record || index < 0 || static_cast<quint32>(index) >= readUInt32(record, 5)) {
+        return entry;
+    }
+
+    const auto *data = entries_ + (readUInt32(record, 4) + static_cast<quint32>(index)) * kEntryRecordSize;
+    const auto *fields = data + 8;
+    entry.id = qFromLittleEndian<qint64>(data);
+    entry.title = rawBytes(readUInt32(fields, 0), readUInt32(fields, 1));
+    entry.url = rawBytes(readUInt32(fields, 2), readUInt32(fields, 3));
+    entry.sortKey = rawBytes(readUInt32(fields, 4), readUInt32(fields, 5));
+    return entry;
+}
+
+const uchar *TraySnapshot::groupRecord(int group) const
+{
+    if (!data_ || group < 0 || static_cast<quint32>(group) >= groupCount_) {
+        return nullptr;
+    }
+    return groups_ + group * kGroupRecordSize;
+}
+
+QByteArray TraySnapshot::bytes(quint32 offset, quint32 length) const
+{
+    const auto raw = rawBytes(offset, length);
+    return QByteArray(raw.constData(), raw.size());
+}
+
+QByteArray TraySnapshot::rawBytes(quint32 offset, quint32 length) const
+{
+    if (!data_ || static_cast<quint64>(offset) + length > stringsSize_) {
+        return {};
+    }
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(strings_ + offset), static_cast<int>(length));
+}
+
+void TraySnapshot::close()
+{
+    if (data_) {
+        file_.unmap(const_cast<uchar *>(data_));
+    }
+    data_ = nullptr;
+    groups_ = nullptr;
+    entries_ = nullptr;
+    strings_ = nullptr;
+    groupCount_ = 0;
+    entryCount_ = 0;
+    stringsSize_ = 0;
+    stampLength_ = 0;
+    file_.close();
+}
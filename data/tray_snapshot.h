@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include "link_groups.h"
+
+// Read-only, memory-mapped copy of LinkGroups written next to the database
+// so the tray menu can be shown before SQLite is even opened.
+//
+// Layout (all integers little-endian):
+//   header   magic "LDTS", version, group count, entry count,
+//            string blob size, stamp length              6 x u32
+//   groups   category offset/length, key offset/length,
+//            first entry, entry count                    6 x u32 each
+//   entries  id (i64), title, url and sort key
+//            offset/length pairs                         i64 + 6 x u32 each
+//   strings  stamp, then UTF-8 text and raw sort keys
+//
+// Groups and the entries inside them are stored in LinkGroups order, so
+// nothing is sorted again on load. The stamp records the state of the
+// database files when the snapshot was written; see databaseStamp().
+class TraySnapshot {
+public:
+    // Strings point into the mapped file and are only valid while it is open.
+    struct Entry {
+        qint64 id = -1;
+        QByteArray title;
+        QByteArray url;
+        QByteArray sortKey;
+    };
+
+    TraySnapshot() = default;
+    ~TraySnapshot();
+    TraySnapshot(const TraySnapshot &) = delete;
+    TraySnapshot &operator=(const TraySnapshot &) = delete;
+
+    static QString pathFor(const QString &databasePath);
+    // Fingerprint of the database and WAL files: sizes, modification times
+    // and the change counter from the SQLite header. Any committed write
+    // changes it, so a snapshot whose stamp still matches is current.
+    static QByteArray databaseStamp(const QString &databasePath);
+    static bool write(const QString &path, const LinkGroups &groups, const QByteArray &stamp,
+                      QString *errorMessage);
+
+    // Returns false with an empty errorMessage when there is no snapshot.
+    bool open(const QString &path, QString *errorMessage);
+    bool isOpen() const;
+
+    QByteArray stamp() const;
+    int groupCount() const;
+    int linkCount() const;
+    QString category(int group) const;
+    QByteArray groupKey(int group) const;
+    int entryCount(int group) const;
+    Entry entry(int group, int index) const;
+
+    static constexpr quint32 kVersion = 1;
+
+private:
+    const uchar *groupRecord(int group) const;
+    QByteArray bytes(quint32 offset, quint32 length) const;
+    QByteArray rawBytes(quint32 offset, quint32 length) const;
+    void close();
+
+    QFile file_;
+    const uchar *data_ = nullptr;
+    const uchar *groups_ = nullptr;
+    const uchar *entries_ = nullptr;
+    const uchar *strings_ = nullptr;
+    quint32 groupCount_ = 0;
+    quint32 entryCount_ = 0;
+    quint32 stringsSize_ = 0;
+    quint32 stampLength_ = 0;
+};
@@ -0,0 +1,51 @@
+#include "usage_log.h"
+
+#include <utility>
+
+UsageLog::UsageLog(int capacity)
+    : slots_(static_cast<size_t>(qMax(1, capacity)))
+{
+}
+
+bool UsageLog::record(qint64 linkId, qint64 visitedAt)
+{
+    const int capacity = static_cast<int>(slots_.size());
+    const int tail = (head_ + size_) % capacity;
+    slots_[tail] = {linkId, visitedAt};
+    if (size_ < capacity) {
+        ++size_;
+        return true;
+    }
+    head_ = (head_ + 1) % capacity;
+    return false;
+}
+
+QList<LinkVisit> UsageLog::drain()
+{
+    const int capacity = static_cast<int>(slots_.size());
+    QList<LinkVisit> visits;
+    visits.reserve(size_);
+    for (int i = 0; i < size_; ++i) {
+        auto &slot = slots_[(head_ + i) % capacity];
+        visits.append(std::move(slot));
+        slot = LinkVisit();
+    }
+    head_ = 0;
+    size_ = 0;
+    return visits;
+}
+
+int UsageLog::size() const
+{
+    return size_;
+}
+
+int UsageLog::capacity() const
+{
+    return static_cast<int>(slots_.size());
+}
+
+bool UsageLog::isEmpty() const
+{
+    return size_ == 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <QList>
+#include <QtGlobal>
+
+struct LinkVisit {
+    qint64 linkId = -1;
+    // Seconds since the epoch.
+    qint64 visitedAt = 0;
+};
+
+// Fixed-size ring buffer of link opens waiting to be written to SQLite.
+// Recording never allocates or touches the database, so opening a link
+// stays instant; the owner drains the buffer in batches. When the buffer is
+// full the oldest visit is overwritten.
+class UsageLog {
+public:
+    explicit UsageLog(int capacity = kDefaultCapacity);
+
+    // Returns false when an unflushed visit had to be dropped.
+    bool record(qint64 linkId, qint64 visitedAt);
+    // Oldest first; leaves the log empty.
+    QList<LinkVisit> drain();
+
+    int size() const;
+    int capacity() const;
+    bool isEmpty() const;
+
+    static constexpr int kDefaultCapacity = 256;
+
+private:
+    std::vector<LinkVisit> slots_;
+    int head_ = 0;
+    int size_ = 0;
+};
@@ -0,0 +1,109 @@
+#include "quick_search_dialog.h"
+#include "ui_quick_search_dialog.h"
+
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QListWidgetItem>
+
+namespace {
+// Qt::UserRole holds the URL.
+constexpr int kLinkIdRole = Qt::UserRole + 1;
+}
+
+QuickSearchDialog::QuickSearchDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setupUi();
+}
+
+QuickSearchDialog::~QuickSearchDialog()
+{
+    delete ui_;
+}
+
+QString QuickSearchDialog::query() const
+{
+    return ui_->searchLineEdit->text().trimmed();
+}
+
+void QuickSearchDialog::setResults(const QString &query, const QList<LinkRecord> &records)
+{
+    // Results for anything but the current text are stale.
+    if (query != this->query()) {
+        return;
+    }
+
+    ui_->resultsListWidget->clear();
+    for (const auto &record : records) {
+        auto *item = new QListWidgetItem(record.link.title + " - " + record.link.category,
+                                         ui_->resultsListWidget);
+        item->setToolTip(record.link.url);
+        item->setData(Qt::UserRole, record.link.url);
+        item->setData(kLinkIdRole, record.id);
+    }
+    if (ui_->resultsListWidget->count() > 0) {
+        ui_->resultsListWidget->setCurrentRow(0);
+    }
+}
+
+void QuickSearchDialog::activate()
+{
+    ui_->searchLineEdit->clear();
+    ui_->resultsListWidget->clear();
+    show();
+    raise();
+    activateWindow();
+    ui_->searchLineEdit->setFocus();
+}
+
+void QuickSearchDialog::accept()
+{
+    const auto *item = ui_->resultsListWidget->currentItem();
+    if (!item) {
+        return;
+    }
+
+    emit linkActivated(item->data(kLinkIdRole).toLongLong(), item->data(Qt::UserRole).toString());
+    QDialog::accept();
+}
+
+void QuickSearchDialog::keyPressEvent(QKeyEvent *event)
+{
+    switch (event->key()) {
+    case Qt::Key_Down:
+        moveSelection(1);
+        return;
+    case Qt::Key_Up:
+        moveSelection(-1);
+        return;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        accept();
+        return;
+    default:
+        QDialog::keyPressEvent(event);
+    }
+}
+
+void QuickSearchDialog::setupUi()
+{
+    ui_ = new Ui::QuickSearchDialog;
+    ui_->setupUi(this);
+
+    ui_->searchLineEdit->setPlaceholderText("Type to find a link");
+
+    connect(ui_->searchLineEdit, &QLineEdit::textChanged, this, [this]() { emit queryChanged(query()); });
+    connect(ui_->resultsListWidget, &QListWidget::itemActivated, this, &QuickSearchDialog::accept);
+}
+
+void QuickSearchDialog::moveSelection(int delta)
+{
+    const int count = ui_->resultsListWidget->count();
+    if (count == 0) {
+        return;
+    }
+
+    const int row = qBound(0, ui_->resultsListWidget->currentRow() + delta, count - 1);
+    ui_->resultsListWidget->setCurrentRow(row);
+}
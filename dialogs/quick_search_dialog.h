@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QDialog>
+#include <QList>
+
+#include "../models/link_item.h"
+
+namespace Ui {
+class QuickSearchDialog;
+}
+
+// Type-to-search popup for opening a link from the tray. The dialog only
+// displays results; whoever owns it answers queryChanged() with setResults().
+class QuickSearchDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit QuickSearchDialog(QWidget *parent = nullptr);
+    ~QuickSearchDialog();
+
+    QString query() const;
+    void setResults(const QString &query, const QList<LinkRecord> &records);
+    void activate();
+
+signals:
+    void queryChanged(const QString &query);
+    void linkActivated(qint64 id, const QString &url);
+
+protected:
+    void accept() override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    void setupUi();
+    void moveSelection(int delta);
+
+    Ui::QuickSearchDialog *ui_ = nullptr;
+};
@@ -0,0 +1,55 @@
+#include "storage_settings_dialog.h"
+#include "ui_storage_settings_dialog.h"
+
+#include <QDialogButtonBox>
+#include <QPushButton>
+
+StorageSettingsDialog::StorageSettingsDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setupUi();
+}
+
+StorageSettingsDialog::~StorageSettingsDialog()
+{
+    delete ui_;
+}
+
+void StorageSettingsDialog::setProfile(const StorageProfile &profile)
+{
+    ui_->walCheckBox->setChecked(profile.walJournal);
+    ui_->synchronousComboBox->setCurrentIndex(static_cast<int>(profile.synchronous));
+    ui_->cacheSpinBox->setValue(profile.cacheSizeMiB);
+    ui_->mmapSpinBox->setValue(profile.mmapSizeMiB);
+    ui_->tempStoreCheckBox->setChecked(profile.memoryTempStore);
+    ui_->maintenanceSpinBox->setValue(profile.maintenanceIntervalMinutes);
+}
+
+StorageProfile StorageSettingsDialog::profile() const
+{
+    StorageProfile profile;
+    profile.walJournal = ui_->walCheckBox->isChecked();
+    profile.synchronous = static_cast<StorageProfile::Synchronous>(ui_->synchronousComboBox->currentIndex());
+    profile.cacheSizeMiB = ui_->cacheSpinBox->value();
+    profile.mmapSizeMiB = ui_->mmapSpinBox->value();
+    profile.memoryTempStore = ui_->tempStoreCheckBox->isChecked();
+    profile.maintenanceIntervalMinutes = ui_->maintenanceSpinBox->value();
+    return profile;
+}
+
+void StorageSettingsDialog::setupUi()
+{
+    setModal(true);
+
+    ui_ = new Ui::StorageSettingsDialog;
+    ui_->setupUi(this);
+
+    // Same order as StorageProfile::Synchronous.
+    ui_->synchronousComboBox->addItems({"Off (fastest, unsafe on crash)", "Normal", "Full (safest)"});
+    ui_->maintenanceSpinBox->setSpecialValueText("Never");
+
+    auto *defaultsButton = ui_->buttonBox->button(QDialogButtonBox::RestoreDefaults);
+    connect(defaultsButton, &QPushButton::clicked, this, [this]() { setProfile(StorageProfile()); });
+    connect(ui_->buttonBox, &QDialogButtonBox::accepted, this, &StorageSettingsDialog::accept);
+    connect(ui_->buttonBox, &QDialogButtonBox::rejected, this, &StorageSettingsDialog::reject);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QDialog>
+
+#include "../data/storage_profile.h"
+
+namespace Ui {
+class StorageSettingsDialog;
+}
+
+class StorageSettingsDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit StorageSettingsDialog(QWidget *parent = nullptr);
+    ~StorageSettingsDialog();
+
+    void setProfile(const StorageProfile &profile);
+    StorageProfile profile() const;
+
+private:
+    void setupUi();
+
+    Ui::StorageSettingsDialog *ui_ = nullptr;
+};
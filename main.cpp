@@ -1,4 +1,7 @@
 #include "main.h"
+#include "data/database_service.h"
+#include "single_instance.h"
+#include "tracing.h"
 #include "utilities.h"
 #include "window/main_window.h"
 
@@ -8,21 +11,79 @@
 #include <QIcon>
 #include <QLockFile>
 #include <QMessageBox>
+#include <QSettings>
+#include <QThread>
+
+#include <cstdio>
+
+namespace {
+// How long a launch with commands waits for an instance that holds the lock
+// but has not started its server yet.
+constexpr int kForwardRetryCount = 50;
+constexpr int kForwardRetryDelayMs = 100;
+
+void setApplicationNames()
+{
+    QCoreApplication::setApplicationName(AppConfig::kName);
+    QCoreApplication::setOrganizationName(AppConfig::kOrganization);
+    QCoreApplication::setOrganizationDomain(AppConfig::kDomain);
+}
+
+// Returns true once the commands reached a running instance.
+bool forwardCommands(const QList<InstanceCommand> &commands, int attempts)
+{
+    QString errorMessage;
+    for (int attempt = 0; attempt < attempts; ++attempt) {
+        if (InstanceServer::send(commands, &errorMessage)) {
+            return true;
+        }
+        if (!errorMessage.isEmpty()) {
+            std::fprintf(stderr, "%s\n", qPrintable(errorMessage));
+            return false;
+        }
+        if (attempt + 1 < attempts) {
+            QThread::msleep(kForwardRetryDelayMs);
+        }
+    }
+    return false;
+}
+}
 
 int main(int argc, char *argv[])
 {
+    StartupTimer::start();
+
+    QList<InstanceCommand> commands;
+    {
+        // A forwarding launch only needs QtCore: no display connection, no
+        // widgets and no database.
+        QCoreApplication client(argc, argv);
+        setApplicationNames();
+        QString errorMessage;
+        if (!InstanceServer::parseArguments(QCoreApplication::arguments(), &commands, &errorMessage)) {
+            std::fprintf(stderr, "%s\n", qPrintable(errorMessage));
+            return 2;
+        }
+        if (!commands.isEmpty() && forwardCommands(commands, 1)) {
+            return 0;
+        }
+    }
+
     QApplication a(argc, argv);
-    QApplication::setApplicationName(AppConfig::kName);
-    QApplication::setOrganizationName(AppConfig::kOrganization);
-    QApplication::setOrganizationDomain(AppConfig::kDomain);
+    setApplicationNames();
     QApplication::setQuitOnLastWindowClosed(false);
+    Tracing::setEnabled(Tracing::requested(QSettings()));
 
     const auto lockPath = AppPaths::appDataPath("linksdash.lock");
     QDir().mkpath(QFileInfo(lockPath).dir().path());
     QLockFile lockFile(lockPath);
     lockFile.setStaleLockTime(0);
     if (!lockFile.tryLock()) {
-        const auto message = lockFile.error() == QLockFile::LockFailedError
+        const bool locked = lockFile.error() == QLockFile::LockFailedError;
+        if (locked && !commands.isEmpty()) {
+            return forwardCommands(commands, kForwardRetryCount) ? 0 : 1;
+        }
+        const auto message = locked
             ? "LinksDash is already running."
             : "Unable to start LinksDash due to a lock file error.";
         QMessageBox::warning(nullptr, "LinksDash", message);
@@ -33,6 +94,32 @@ int main(int argc, char *argv[])
     if (!appIcon.isNull()) {
         QApplication::setWindowIcon(appIcon);
     }
-    MainWindow w;
-    return a.exec();
+    DatabaseManager::setStorageProfile(StorageProfile::load(QSettings()));
+
+    int status = 0;
+    {
+        MainWindow w;
+
+        InstanceServer server;
+        QString errorMessage;
+        if (!server.listen(&errorMessage)) {
+            qWarning("Unable to accept commands from other launches: %s", qPrintable(errorMessage));
+        }
+        QObject::connect(&server, &InstanceServer::commandsReceived, &w, &MainWindow::handleInstanceCommands);
+        // Commands given to the first launch run here once the database is open.
+        w.handleInstanceCommands(commands);
+        status = a.exec();
+    }
+
+    // The window is gone and its worker joined, so shutdown is traced too.
+    if (Tracing::isEnabled()) {
+        const auto tracePath = Tracing::defaultPath();
+        QString errorMessage;
+        if (Tracing::write(tracePath, &errorMessage)) {
+            qInfo("Trace written to %s", qPrintable(tracePath));
+        } else {
+            qWarning("Unable to write the trace: %s", qPrintable(errorMessage));
+        }
+    }
+    return status;
 }
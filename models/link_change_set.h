@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QList>
+
+#include "link_item.h"
+
+// What one save wrote, or what other writers changed since the last poll.
+// Inserted records carry their generated ids. Changes read back from the
+// change log list every live row as updated.
+struct LinkChangeSet {
+    QList<LinkRecord> inserted;
+    QList<LinkRecord> updated;
+    QList<qint64> removed;
+
+    bool isEmpty() const
+    {
+        return inserted.isEmpty() && updated.isEmpty() && removed.isEmpty();
+    }
+
+    int size() const
+    {
+        return inserted.size() + updated.size() + removed.size();
+    }
+};
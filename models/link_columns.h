@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QVector>
+
+#include "../data/string_pool.h"
+
+// A copy of LinksModel's rows, indexed by model row, for reading on a worker
+// thread. Columns, arena and pool are implicitly shared, so taking a copy is
+// cheap and the model only pays for it when it next changes.
+struct LinkColumns {
+    // Table columns, in display order.
+    enum Column {
+        TitleColumn,
+        CategoryColumn,
+        UrlColumn,
+        ColumnCount
+    };
+
+    QVector<StringArena::Ref> titles;
+    // LinkSchema::sortKey() of each title.
+    QVector<StringArena::Ref> sortKeys;
+    QVector<quint32> categoryIds;
+    QVector<StringArena::Ref> urls;
+    StringArena strings;
+    CategoryPool categories;
+
+    int rowCount() const
+    {
+        return static_cast<int>(titles.size());
+    }
+};
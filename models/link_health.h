@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QString>
+
+// Result of the last probe of a link's URL, as stored in link_health.
+struct LinkHealth {
+    qint64 linkId = -1;
+    // Final HTTP status after redirects; 0 when no response arrived.
+    int httpStatus = 0;
+    int latencyMs = 0;
+    // Seconds since the epoch.
+    qint64 checkedAt = 0;
+    // Network error text when httpStatus is 0.
+    QString error;
+
+    // Unreachable, gone, or failing on the server side. Statuses such as 401,
+    // 403 and 429 mean the page exists but refused the probe.
+    bool isDead() const
+    {
+        return httpStatus == 0 || httpStatus == 404 || httpStatus == 410 || httpStatus >= 500;
+    }
+
+    QString describe() const
+    {
+        return httpStatus == 0 ? error : QString("HTTP %1").arg(httpStatus);
+    }
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QByteArray>
 #include <QString>
 
 struct LinkItem {
@@ -7,3 +8,11 @@ struct LinkItem {
     QString category;
     QString url;
 };
+
+struct LinkRecord {
+    qint64 id = -1;
+    LinkItem link;
+    // LinkSchema::sortKey() of the title, as stored with the row. Empty when
+    // the record did not come from the database; users compute it on demand.
+    QByteArray sortKey;
+};
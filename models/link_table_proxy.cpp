@@ -0,0 +1,375 @@
+#include "link_table_proxy.h"
+
+#include "../tracing.h"
+#include "../utilities.h"
+#include "links_model.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+LinkTableProxy::LinkTableProxy(LinksModel *source, QObject *parent)
+    : QAbstractProxyModel(parent)
+    , source_(source)
+    , generation_(std::make_shared<std::atomic_int>(0))
+{
+    pool_.setMaxThreadCount(1);
+    // Keystrokes and pages that arrive together make one query.
+    queryTimer_.setSingleShot(true);
+    queryTimer_.setInterval(0);
+    connect(&queryTimer_, &QTimer::timeout, this, &LinkTableProxy::runQuery);
+
+    QAbstractProxyModel::setSourceModel(source_);
+    connect(source_, &QAbstractItemModel::rowsAboutToBeInserted, this,
+            &LinkTableProxy::handleRowsAboutToBeInserted);
+    connect(source_, &QAbstractItemModel::rowsInserted, this, &LinkTableProxy::handleRowsInserted);
+    connect(source_, &QAbstractItemModel::rowsAboutToBeRemoved, this, &LinkTableProxy::handleRowsAboutToBeRemoved);
+    connect(source_, &QAbstractItemModel::rowsRemoved, this, &LinkTableProxy::handleRowsRemoved);
+    connect(source_, &QAbstractItemModel::dataChanged, this, &LinkTableProxy::handleDataChanged);
+    connect(source_, &QAbstractItemModel::headerDataChanged, this, &LinkTableProxy::handleHeaderDataChanged);
+    connect(source_, &QAbstractItemModel::modelAboutToBeReset, this, &LinkTableProxy::handleModelAboutToBeReset);
+    connect(source_, &QAbstractItemModel::modelReset, this, &LinkTableProxy::handleModelReset);
+    connect(source_, &LinksModel::fetchFinished, this, &LinkTableProxy::handleFetchFinished);
+}
+
+LinkTableProxy::~LinkTableProxy()
+{
+    ++*generation_;
+    pool_.waitForDone();
+}
+
+void LinkTableProxy::setFilterText(const QString &text)
+{
+    const auto filter = LinkTable::parseFilter(text);
+    if (filter == query_.filter) {
+        return;
+    }
+    query_.filter = filter;
+    scheduleQuery();
+}
+
+void LinkTableProxy::sort(int column, Qt::SortOrder order)
+{
+    auto &keys = query_.sortKeys;
+    if (column < 0) {
+        if (keys.isEmpty()) {
+            return;
+        }
+        keys.clear();
+    } else {
+        for (int i = static_cast<int>(keys.size()) - 1; i >= 0; --i) {
+            if (keys.at(i).column == column) {
+                keys.removeAt(i);
+            }
+        }
+        keys.prepend({column, order});
+        while (keys.size() > kMaxSortKeys) {
+            keys.removeLast();
+        }
+    }
+    scheduleQuery();
+}
+
+QModelIndex LinkTableProxy::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!proxyIndex.isValid()) {
+        return {};
+    }
+    const int row = identity_ ? proxyIndex.row() : sourceRows_.value(proxyIndex.row(), -1);
+    return row < 0 ? QModelIndex() : source_->index(row, proxyIndex.column());
+}
+
+QModelIndex LinkTableProxy::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid()) {
+        return {};
+    }
+    const int row = proxyRow(sourceIndex.row());
+    return row < 0 ? QModelIndex() : createIndex(row, sourceIndex.column());
+}
+
+QModelIndex LinkTableProxy::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || row < 0 || row >= rowCount() || column < 0 || column >= columnCount()) {
+        return {};
+    }
+    return createIndex(row, column);
+}
+
+QModelIndex LinkTableProxy::parent(const QModelIndex &) const
+{
+    return {};
+}
+
+bool LinkTableProxy::hasChildren(const QModelIndex &parent) const
+{
+    return !parent.isValid() && rowCount() > 0;
+}
+
+int LinkTableProxy::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return identity_ ? source_->rowCount() : static_cast<int>(sourceRows_.size());
+}
+
+int LinkTableProxy::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : source_->columnCount();
+}
+
+QVariant LinkTableProxy::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal) {
+        return source_->headerData(section, orientation, role);
+    }
+    // Rows keep their source header, like QSortFilterProxyModel.
+    const int row = identity_ ? section : sourceRows_.value(section, -1);
+    return row < 0 ? QVariant() : source_->headerData(row, orientation, role);
+}
+
+bool LinkTableProxy::canFetchMore(const QModelIndex &parent) const
+{
+    // A filtered or sorted view asked for pages one at a time would pull in
+    // the whole table and re-evaluate it after every page.
+    return query_.isIdentity() && source_->canFetchMore(mapToSource(parent));
+}
+
+void LinkTableProxy::fetchMore(const QModelIndex &parent)
+{
+    if (query_.isIdentity()) {
+        source_->fetchMore(mapToSource(parent));
+    }
+}
+
+void LinkTableProxy::scheduleQuery()
+{
+    queryTimer_.start();
+}
+
+void LinkTableProxy::runQuery()
+{
+    const int generation = ++*generation_;
+    if (query_.isIdentity()) {
+        if (!identity_) {
+            applyRows(true, {});
+        }
+        return;
+    }
+    if (source_->hasMoreRows()) {
+        // handleFetchFinished() runs the query once the rest has arrived.
+        source_->fetchAll();
+        return;
+    }
+
+    const auto columns = source_->columns();
+    const auto query = query_;
+    const auto current = generation_;
+    const auto future = QtConcurrent::run(&pool_, [columns, query, current, generation]() {
+        const Tracing::Span span("LinkTable::evaluate");
+        QVector<int> rows;
+        LinkTable::evaluate(columns, query, [&current, generation]() {
+            return current->load(std::memory_order_relaxed) != generation;
+        }, &rows);
+        return rows;
+    });
+    // A cancelled query always has a newer generation, so its empty result
+    // is dropped here too.
+    Futures::whenFinished(future, this, [this, generation, revision = sourceRevision_](const QVector<int> &rows) {
+        if (generation != generation_->load(std::memory_order_relaxed) || revision != sourceRevision_) {
+            return;
+        }
+        const Tracing::Span span("LinkTableProxy::applyRows");
+        applyRows(false, rows);
+    });
+}
+
+void LinkTableProxy::applyRows(bool identity, const QVector<int> &rows)
+{
+    emit layoutAboutToBeChanged();
+    const auto persistent = persistentIndexList();
+    QVector<int> persistentSourceRows;
+    persistentSourceRows.reserve(persistent.size());
+    for (const auto &index : persistent) {
+        persistentSourceRows.append(mapToSource(index).row());
+    }
+
+    identity_ = identity;
+    sourceRows_ = identity ? QVector<int>() : rows;
+    rebuildProxyRows();
+
+    QModelIndexList moved;
+    moved.reserve(persistent.size());
+    for (int i = 0; i < persistent.size(); ++i) {
+        const int row = proxyRow(persistentSourceRows.at(i));
+        moved.append(row < 0 ? QModelIndex() : index(row, persistent.at(i).column()));
+    }
+    changePersistentIndexList(persistent, moved);
+    emit layoutChanged();
+}
+
+void LinkTableProxy::rebuildProxyRows()
+{
+    if (identity_) {
+        proxyRows_.clear();
+        return;
+    }
+    proxyRows_.fill(-1, source_->rowCount());
+    for (int row = 0; row < sourceRows_.size(); ++row) {
+        proxyRows_[sourceRows_.at(row)] = row;
+    }
+}
+
+int LinkTableProxy::proxyRow(int sourceRow) const
+{
+    if (identity_) {
+        return sourceRow >= 0 && sourceRow < source_->rowCount() ? sourceRow : -1;
+    }
+    return proxyRows_.value(sourceRow, -1);
+}
+
+void LinkTableProxy::handleRowsAboutToBeInserted(const QModelIndex &parent, int first, int last)
+{
+    if (!parent.isValid() && identity_) {
+        beginInsertRows(QModelIndex(), first, last);
+    }
+}
+
+void LinkTableProxy::handleRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    ++sourceRevision_;
+    if (identity_) {
+        endInsertRows();
+    } else {
+        // New rows stay hidden until the next query has placed them.
+        const int count = last - first + 1;
+        for (auto &row : sourceRows_) {
+            row += row >= first ? count : 0;
+        }
+        rebuildProxyRows();
+    }
+    if (!query_.isIdentity()) {
+        scheduleQuery();
+    }
+}
+
+void LinkTableProxy::handleRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+    if (identity_) {
+        beginRemoveRows(QModelIndex(), first, last);
+        return;
+    }
+
+    QVector<int> removed;
+    for (int row = first; row <= last; ++row) {
+        const int proxy = proxyRow(row);
+        if (proxy >= 0) {
+            removed.append(proxy);
+        }
+    }
+    if (removed.isEmpty()) {
+        return;
+    }
+
+    // Contiguous proxy rows go in one notification, last run first. Only
+    // sourceRows_ has to be right while views react, since they map proxy
+    // rows to source rows, so the reverse map is rebuilt once at the end.
+    std::sort(removed.begin(), removed.end(), std::greater<int>());
+    int end = 0;
+    while (end < removed.size()) {
+        const int last = removed.at(end);
+        int first = last;
+        while (++end < removed.size() && removed.at(end) == first - 1) {
+            first = removed.at(end);
+        }
+        beginRemoveRows(QModelIndex(), first, last);
+        sourceRows_.remove(first, last - first + 1);
+        endRemoveRows();
+    }
+    rebuildProxyRows();
+}
+
+void LinkTableProxy::handleRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    ++sourceRevision_;
+    if (identity_) {
+        endRemoveRows();
+    } else {
+        const int count = last - first + 1;
+        for (auto &row : sourceRows_) {
+            row -= row > last ? count : 0;
+        }
+        rebuildProxyRows();
+    }
+    if (!query_.isIdentity()) {
+        scheduleQuery();
+    }
+}
+
+void LinkTableProxy::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                       const QVector<int> &roles)
+{
+    if (identity_) {
+        emit dataChanged(index(topLeft.row(), topLeft.column()), index(bottomRight.row(), bottomRight.column()),
+                         roles);
+    } else if (topLeft.row() == bottomRight.row()) {
+        const int row = proxyRow(topLeft.row());
+        if (row >= 0) {
+            emit dataChanged(index(row, topLeft.column()), index(row, bottomRight.column()), roles);
+        }
+    } else if (!sourceRows_.isEmpty()) {
+        const int last = static_cast<int>(sourceRows_.size()) - 1;
+        emit dataChanged(index(0, topLeft.column()), index(last, bottomRight.column()), roles);
+    }
+
+    // An edit can move a row in or out of the filter, or along the sort.
+    if (!query_.isIdentity() && (roles.isEmpty() || roles.contains(Qt::DisplayRole))) {
+        scheduleQuery();
+    }
+}
+
+void LinkTableProxy::handleHeaderDataChanged(Qt::Orientation orientation, int first, int last)
+{
+    if (orientation == Qt::Horizontal || identity_) {
+        emit headerDataChanged(orientation, first, last);
+    } else if (!sourceRows_.isEmpty()) {
+        emit headerDataChanged(orientation, 0, static_cast<int>(sourceRows_.size()) - 1);
+    }
+}
+
+void LinkTableProxy::handleModelAboutToBeReset()
+{
+    beginResetModel();
+}
+
+void LinkTableProxy::handleModelReset()
+{
+    ++sourceRevision_;
+    sourceRows_.clear();
+    proxyRows_.clear();
+    endResetModel();
+    if (!query_.isIdentity()) {
+        scheduleQuery();
+    }
+}
+
+void LinkTableProxy::handleFetchFinished()
+{
+    if (!query_.isIdentity()) {
+        scheduleQuery();
+    }
+}
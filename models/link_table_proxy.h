@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QAbstractProxyModel>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+#include "../data/link_table_query.h"
+
+class LinksModel;
+
+// Filters and sorts LinksModel for the table view without scanning rows on
+// the GUI thread. A change of filter, sort or source rows queues one
+// LinkTable::evaluate() over a LinkColumns snapshot on a worker thread, and
+// starting a newer query cancels the one still running. The result is a
+// row permutation, so mapping an index either way is an array lookup.
+// Without a filter or sort, rows pass straight through and source inserts
+// are forwarded as they happen, so paging works as before. A filter or sort
+// covers the whole table: the rest of it is loaded into LinksModel in one
+// request before the first evaluation, and the view stops paging while it
+// is active. From then on the model holds every row, at any table size.
+class LinkTableProxy : public QAbstractProxyModel {
+    Q_OBJECT
+
+public:
+    explicit LinkTableProxy(LinksModel *source, QObject *parent = nullptr);
+    ~LinkTableProxy() override;
+
+    // Filter text as understood by LinkTable::parseFilter().
+    void setFilterText(const QString &text);
+    // The column becomes the primary sort key and earlier ones break its
+    // ties. A negative column clears the sort.
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    void scheduleQuery();
+    void runQuery();
+    // Installs a new mapping as a layout change, keeping persistent indexes
+    // (and with them the view's selection) on the rows they pointed at.
+    void applyRows(bool identity, const QVector<int> &rows);
+    void rebuildProxyRows();
+    int proxyRow(int sourceRow) const;
+
+    void handleRowsAboutToBeInserted(const QModelIndex &parent, int first, int last);
+    void handleRowsInserted(const QModelIndex &parent, int first, int last);
+    void handleRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void handleRowsRemoved(const QModelIndex &parent, int first, int last);
+    void handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void handleHeaderDataChanged(Qt::Orientation orientation, int first, int last);
+    void handleModelAboutToBeReset();
+    void handleModelReset();
+    void handleFetchFinished();
+
+    LinksModel *source_ = nullptr;
+    LinkTableQuery query_;
+    // While identity_ is set, proxy and source rows are the same and both
+    // vectors are empty. Otherwise proxy row -> source row, and back with
+    // -1 for rows filtered out.
+    bool identity_ = true;
+    QVector<int> sourceRows_;
+    QVector<int> proxyRows_;
+
+    QTimer queryTimer_;
+    QThreadPool pool_;
+    // Bumped by every query; a worker stops once it no longer matches.
+    std::shared_ptr<std::atomic_int> generation_;
+    // Bumped whenever source rows move, so results computed over an older
+    // snapshot are dropped; the move has queued a fresh query already.
+    int sourceRevision_ = 0;
+
+    static constexpr int kMaxSortKeys = 3;
+};
@@ -0,0 +1,562 @@
+#include "links_model.h"
+
+#include "../data/async_database.h"
+#include "../data/link_schema.h"
+#include "../tracing.h"
+#include "../utilities.h"
+
+#include <QDateTime>
+#include <QHash>
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+template <typename T>
+void insertColumnRange(QVector<T> &column, int position, QVector<T> &values)
+{
+    column.insert(position, values.size(), T());
+    std::move(values.begin(), values.end(), column.begin() + position);
+}
+
+QByteArray titleSortKey(const LinkRecord &record)
+{
+    return record.sortKey.isEmpty() ? LinkSchema::sortKey(record.link.title) : record.sortKey;
+}
+}
+
+LinksModel::LinksModel(AsyncDatabase *database, QObject *parent)
+    : QAbstractTableModel(parent)
+    , database_(database)
+{
+}
+
+void LinksModel::select()
+{
+    const Tracing::Span span("LinksModel::select");
+    beginResetModel();
+    clearRows();
+    endResetModel();
+
+    ++generation_;
+    atEnd_ = false;
+    fetching_ = false;
+    requestPage();
+}
+
+void LinksModel::submitAll()
+{
+    const Tracing::Span span("LinksModel::submitAll");
+    if (saving_) {
+        return;
+    }
+    if (!hasPendingChanges()) {
+        emit submitFinished(true, QString());
+        return;
+    }
+
+    LinkBatch batch;
+    batch.removed = removedIds_;
+    for (int row = 0; row < ids_.size(); ++row) {
+        if (states_.at(row) == RowState::Updated) {
+            batch.updated.append({ids_.at(row), link(row)});
+        } else if (states_.at(row) == RowState::Inserted) {
+            batch.inserted.append(link(row));
+        }
+    }
+
+    saving_ = true;
+    const int generation = generation_;
+    Futures::whenFinished(database_->commit(batch), this, [this, batch, generation](const LinkBatchResult &result) {
+        saving_ = false;
+        if (!result.ok) {
+            emit submitFinished(false, result.errorMessage);
+            return;
+        }
+
+        LinkChangeSet changes;
+        changes.removed = batch.removed;
+        changes.updated = batch.updated;
+        for (int i = 0; i < batch.inserted.size() && i < result.insertedIds.size(); ++i) {
+            changes.inserted.append({result.insertedIds.at(i), batch.inserted.at(i)});
+        }
+
+        // A select() while saving already replaced the rows that were submitted.
+        if (generation == generation_) {
+            markCommitted(result.insertedIds);
+        }
+        emit linksChanged(changes);
+        emit submitFinished(true, QString());
+    });
+}
+
+bool LinksModel::isSaving() const
+{
+    return saving_;
+}
+
+bool LinksModel::isFetching() const
+{
+    return fetching_;
+}
+
+bool LinksModel::hasMoreRows() const
+{
+    return !atEnd_;
+}
+
+void LinksModel::fetchAll()
+{
+    requestPage(-1);
+}
+
+bool LinksModel::hasPendingChanges() const
+{
+    if (!removedIds_.isEmpty() || pendingInsertCount_ > 0) {
+        return true;
+    }
+    return std::any_of(states_.cbegin(), states_.cend(), [](RowState state) {
+        return state != RowState::Clean;
+    });
+}
+
+int LinksModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ids_.size();
+}
+
+int LinksModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant LinksModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= ids_.size()) {
+        return {};
+    }
+    if (role == Qt::ToolTipRole) {
+        const auto dead = deadLinks_.constFind(ids_.at(index.row()));
+        if (dead == deadLinks_.cend()) {
+            return {};
+        }
+        return QString("Dead link: %1 (checked %2)")
+            .arg(dead->describe(), QDateTime::fromSecsSinceEpoch(dead->checkedAt).toString(Qt::ISODate));
+    }
+    if (role != Qt::DisplayRole && role != Qt::EditRole) {
+        return {};
+    }
+
+    switch (index.column()) {
+    case TitleColumn:
+        return strings_.text(titles_.at(index.row()));
+    case CategoryColumn:
+        return categories_.name(categoryIds_.at(index.row()));
+    case UrlColumn:
+        return strings_.text(urls_.at(index.row()));
+    default:
+        return {};
+    }
+}
+
+QVariant LinksModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    if (orientation == Qt::Vertical) {
+        if (section >= 0 && section < states_.size() && states_.at(section) != RowState::Clean) {
+            return QString("*");
+        }
+        if (section >= 0 && section < ids_.size() && deadLinks_.contains(ids_.at(section))) {
+            return QString("!");
+        }
+        return section + 1;
+    }
+
+    switch (section) {
+    case TitleColumn:
+        return QString("Title");
+    case CategoryColumn:
+        return QString("Category");
+    case UrlColumn:
+        return QString("URL");
+    default:
+        return {};
+    }
+}
+
+bool LinksModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !atEnd_ && !fetching_;
+}
+
+void LinksModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) {
+        return;
+    }
+    requestPage();
+}
+
+qint64 LinksModel::linkId(int row) const
+{
+    if (row < 0 || row >= ids_.size()) {
+        return -1;
+    }
+    return ids_.at(row);
+}
+
+LinkColumns LinksModel::columns() const
+{
+    LinkColumns columns;
+    columns.titles = titles_;
+    columns.sortKeys = sortKeys_;
+    columns.categoryIds = categoryIds_;
+    columns.urls = urls_;
+    columns.strings = strings_;
+    columns.categories = categories_;
+    return columns;
+}
+
+LinkItem LinksModel::link(int row) const
+{
+    if (row < 0 || row >= ids_.size()) {
+        return {};
+    }
+    return {strings_.text(titles_.at(row)), categories_.name(categoryIds_.at(row)), strings_.text(urls_.at(row))};
+}
+
+void LinksModel::appendLink(const LinkItem &link)
+{
+    const int row = ids_.size();
+    beginInsertRows(QModelIndex(), row, row);
+    ids_.append(-1);
+    titles_.append(strings_.add(link.title));
+    sortKeys_.append(strings_.add(LinkSchema::sortKey(link.title)));
+    categoryIds_.append(categories_.intern(link.category));
+    urls_.append(strings_.add(link.url));
+    states_.append(RowState::Inserted);
+    ++pendingInsertCount_;
+    endInsertRows();
+}
+
+bool LinksModel::updateLink(int row, const LinkItem &link)
+{
+    if (row < 0 || row >= ids_.size()) {
+        return false;
+    }
+
+    // A new URL clears the stored check result when it is saved.
+    if (strings_.text(urls_.at(row)) != link.url && deadLinks_.remove(ids_.at(row)) > 0) {
+        emit headerDataChanged(Qt::Vertical, row, row);
+    }
+    releaseStrings(row);
+    titles_[row] = strings_.add(link.title);
+    sortKeys_[row] = strings_.add(LinkSchema::sortKey(link.title));
+    categoryIds_[row] = categories_.intern(link.category);
+    urls_[row] = strings_.add(link.url);
+    if (states_.at(row) == RowState::Clean) {
+        states_[row] = RowState::Updated;
+        emit headerDataChanged(Qt::Vertical, row, row);
+    }
+    compactStrings();
+    emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+    return true;
+}
+
+bool LinksModel::removeLink(int row)
+{
+    if (row < 0 || row >= ids_.size()) {
+        return false;
+    }
+
+    beginRemoveRows(QModelIndex(), row, row);
+    if (states_.at(row) == RowState::Inserted) {
+        --pendingInsertCount_;
+    } else {
+        removedIds_.append(ids_.at(row));
+        committedTailIds_.remove(ids_.at(row));
+    }
+    releaseStrings(row);
+    ids_.remove(row);
+    titles_.remove(row);
+    sortKeys_.remove(row);
+    categoryIds_.remove(row);
+    urls_.remove(row);
+    states_.remove(row);
+    endRemoveRows();
+    compactStrings();
+    return true;
+}
+
+void LinksModel::mergeChanges(const LinkChangeSet &changes)
+{
+    QHash<qint64, int> rows;
+    rows.reserve(ids_.size());
+    for (int row = 0; row < ids_.size(); ++row) {
+        if (ids_.at(row) >= 0) {
+            rows.insert(ids_.at(row), row);
+        }
+    }
+
+    // Updates first: they do not move rows, so the row map stays valid.
+    QList<LinkRecord> added;
+    for (const auto *list : {&changes.inserted, &changes.updated}) {
+        for (const auto &record : *list) {
+            const int row = rows.value(record.id, -1);
+            if (row < 0) {
+                // Later pages fetch higher ids.
+                if (atEnd_ || record.id <= lastFetchedId_) {
+                    added.append(record);
+                }
+                continue;
+            }
+            if (states_.at(row) != RowState::Clean) {
+                continue;
+            }
+            if (strings_.text(urls_.at(row)) != record.link.url && deadLinks_.remove(record.id) > 0) {
+                emit headerDataChanged(Qt::Vertical, row, row);
+            }
+            releaseStrings(row);
+            titles_[row] = strings_.add(record.link.title);
+            sortKeys_[row] = strings_.add(titleSortKey(record));
+            categoryIds_[row] = categories_.intern(record.link.category);
+            urls_[row] = strings_.add(record.link.url);
+            emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+        }
+    }
+
+    QList<int> removedRows;
+    for (const auto id : changes.removed) {
+        const int row = rows.value(id, -1);
+        if (row >= 0 && states_.at(row) == RowState::Clean) {
+            removedRows.append(row);
+        }
+    }
+    std::sort(removedRows.begin(), removedRows.end(), std::greater<int>());
+    for (const int row : std::as_const(removedRows)) {
+        beginRemoveRows(QModelIndex(), row, row);
+        committedTailIds_.remove(ids_.at(row));
+        releaseStrings(row);
+        ids_.remove(row);
+        titles_.remove(row);
+        sortKeys_.remove(row);
+        categoryIds_.remove(row);
+        urls_.remove(row);
+        states_.remove(row);
+        endRemoveRows();
+    }
+    compactStrings();
+
+    if (added.isEmpty()) {
+        return;
+    }
+
+    QVector<qint64> ids;
+    QVector<StringArena::Ref> titles;
+    QVector<StringArena::Ref> sortKeys;
+    QVector<quint32> categoryIds;
+    QVector<StringArena::Ref> urls;
+    for (const auto &record : std::as_const(added)) {
+        ids.append(record.id);
+        titles.append(strings_.add(record.link.title));
+        sortKeys.append(strings_.add(titleSortKey(record)));
+        categoryIds.append(categories_.intern(record.link.category));
+        urls.append(strings_.add(record.link.url));
+    }
+    QVector<RowState> states(ids.size(), RowState::Clean);
+
+    const int first = fetchedRowCount();
+    beginInsertRows(QModelIndex(), first, first + ids.size() - 1);
+    insertColumnRange(ids_, first, ids);
+    insertColumnRange(titles_, first, titles);
+    insertColumnRange(sortKeys_, first, sortKeys);
+    insertColumnRange(categoryIds_, first, categoryIds);
+    insertColumnRange(urls_, first, urls);
+    insertColumnRange(states_, first, states);
+    endInsertRows();
+}
+
+void LinksModel::setLinkHealth(const QList<LinkHealth> &results)
+{
+    bool changed = false;
+    for (const auto &health : results) {
+        if (health.isDead()) {
+            deadLinks_.insert(health.linkId, health);
+            changed = true;
+        } else {
+            changed = deadLinks_.remove(health.linkId) > 0 || changed;
+        }
+    }
+    if (!changed || ids_.isEmpty()) {
+        return;
+    }
+
+    // One notification per batch; finding the affected rows would cost more.
+    const int last = static_cast<int>(ids_.size()) - 1;
+    emit headerDataChanged(Qt::Vertical, 0, last);
+    emit dataChanged(index(0, 0), index(last, ColumnCount - 1), {Qt::ToolTipRole});
+}
+
+int LinksModel::deadLinkCount() const
+{
+    return static_cast<int>(deadLinks_.size());
+}
+
+void LinksModel::requestPage(int limit)
+{
+    if (fetching_ || atEnd_) {
+        return;
+    }
+
+    fetching_ = true;
+    const int generation = generation_;
+    const auto future = database_->loadPage(lastFetchedId_, limit);
+    Futures::whenFinished(future, this, [this, generation, limit](const LinkQueryResult &result) {
+        if (generation != generation_) {
+            return;
+        }
+        fetching_ = false;
+        if (!result.ok) {
+            atEnd_ = true;
+            emit errorOccurred(result.errorMessage);
+        } else {
+            appendPage(result.records, limit);
+        }
+        emit fetchFinished();
+    });
+}
+
+void LinksModel::appendPage(const QList<LinkRecord> &records, int limit)
+{
+    const Tracing::Span span("LinksModel::appendPage");
+    atEnd_ = limit < 0 || records.size() < limit;
+    if (records.isEmpty()) {
+        committedTailIds_.clear();
+        return;
+    }
+    lastFetchedId_ = records.last().id;
+
+    QVector<qint64> ids;
+    QVector<StringArena::Ref> titles;
+    QVector<StringArena::Ref> sortKeys;
+    QVector<quint32> categoryIds;
+    QVector<StringArena::Ref> urls;
+    ids.reserve(records.size());
+    titles.reserve(records.size());
+    sortKeys.reserve(records.size());
+    categoryIds.reserve(records.size());
+    urls.reserve(records.size());
+    for (const auto &record : records) {
+        // Saved inserts are already in the model, behind the fetched rows.
+        if (committedTailIds_.remove(record.id)) {
+            continue;
+        }
+        ids.append(record.id);
+        titles.append(strings_.add(record.link.title));
+        sortKeys.append(strings_.add(titleSortKey(record)));
+        categoryIds.append(categories_.intern(record.link.category));
+        urls.append(strings_.add(record.link.url));
+    }
+
+    if (atEnd_) {
+        committedTailIds_.clear();
+    }
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    // Pending and saved inserts stay at the tail, so fetched rows go in front of them.
+    const int first = fetchedRowCount();
+    const int last = first + ids.size() - 1;
+    QVector<RowState> states(ids.size(), RowState::Clean);
+
+    beginInsertRows(QModelIndex(), first, last);
+    insertColumnRange(ids_, first, ids);
+    insertColumnRange(titles_, first, titles);
+    insertColumnRange(sortKeys_, first, sortKeys);
+    insertColumnRange(categoryIds_, first, categoryIds);
+    insertColumnRange(urls_, first, urls);
+    insertColumnRange(states_, first, states);
+    endInsertRows();
+}
+
+void LinksModel::clearRows()
+{
+    ids_.clear();
+    titles_.clear();
+    sortKeys_.clear();
+    categoryIds_.clear();
+    urls_.clear();
+    strings_.clear();
+    categories_.clear();
+    states_.clear();
+    removedIds_.clear();
+    committedTailIds_.clear();
+    pendingInsertCount_ = 0;
+    lastFetchedId_ = 0;
+    atEnd_ = true;
+}
+
+void LinksModel::releaseStrings(int row)
+{
+    strings_.release(titles_.at(row));
+    strings_.release(sortKeys_.at(row));
+    strings_.release(urls_.at(row));
+}
+
+void LinksModel::compactStrings()
+{
+    if (!strings_.needsCompaction()) {
+        return;
+    }
+
+    StringArena compacted;
+    for (int row = 0; row < ids_.size(); ++row) {
+        titles_[row] = compacted.add(strings_.bytes(titles_.at(row)));
+        sortKeys_[row] = compacted.add(strings_.bytes(sortKeys_.at(row)));
+        urls_[row] = compacted.add(strings_.bytes(urls_.at(row)));
+    }
+    strings_ = compacted;
+}
+
+void LinksModel::markCommitted(const QList<qint64> &insertedIds)
+{
+    // Callers must not edit while isSaving(), so the dirty rows are exactly
+    // the ones that were submitted, and inserted rows appear in batch order.
+    removedIds_.clear();
+    pendingInsertCount_ = 0;
+
+    int next = 0;
+    int firstRow = -1;
+    int lastRow = -1;
+    for (int row = 0; row < states_.size(); ++row) {
+        if (states_.at(row) == RowState::Clean) {
+            continue;
+        }
+        if (states_.at(row) == RowState::Inserted) {
+            ids_[row] = insertedIds.value(next++, -1);
+            // New ids sort after every fetched row; remember them so later
+            // pages do not add them a second time.
+            if (!atEnd_) {
+                committedTailIds_.insert(ids_.at(row));
+            }
+        }
+        states_[row] = RowState::Clean;
+        if (firstRow < 0) {
+            firstRow = row;
+        }
+        lastRow = row;
+    }
+
+    if (firstRow >= 0) {
+        emit headerDataChanged(Qt::Vertical, firstRow, lastRow);
+    }
+}
+
+int LinksModel::fetchedRowCount() const
+{
+    return ids_.size() - pendingInsertCount_ - committedTailIds_.size();
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include "link_change_set.h"
+#include "link_columns.h"
+#include "link_health.h"
+
+class AsyncDatabase;
+
+// Table model over the links table. Rows are stored column-wise and loaded
+// from SQLite in id-ordered pages as the view asks for more; titles and URLs
+// are kept as UTF-8 in a StringArena and categories as interned ids. All reads and
+// writes go through AsyncDatabase, so the model never blocks the GUI thread.
+// Edits stay pending until submitAll(), which writes only the dirty rows,
+// merges the generated ids back in place and reports what it wrote through
+// linksChanged().
+//
+// Loaded rows are never evicted. Opening the table costs one page at any
+// size, but memory grows with every page the view scrolls to, up to the
+// whole table. Evicting pages outside the viewport would need sparse rows,
+// which pending edits and LinkColumns snapshots do not support.
+class LinksModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column {
+        TitleColumn = LinkColumns::TitleColumn,
+        CategoryColumn = LinkColumns::CategoryColumn,
+        UrlColumn = LinkColumns::UrlColumn,
+        ColumnCount = LinkColumns::ColumnCount
+    };
+
+    explicit LinksModel(AsyncDatabase *database, QObject *parent = nullptr);
+
+    void select();
+    void submitAll();
+    bool hasPendingChanges() const;
+    bool isSaving() const;
+    bool isFetching() const;
+    // False once the last page has been loaded.
+    bool hasMoreRows() const;
+    // Loads every row not fetched yet in a single request, for views that
+    // need the whole table at once.
+    void fetchAll();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    qint64 linkId(int row) const;
+    // Every loaded row, for reading on another thread.
+    LinkColumns columns() const;
+    LinkItem link(int row) const;
+    void appendLink(const LinkItem &link);
+    bool updateLink(int row, const LinkItem &link);
+    bool removeLink(int row);
+    // Merges rows written by someone else. Rows with unsaved edits keep
+    // them; new rows are only added where paging would not fetch them later.
+    void mergeChanges(const LinkChangeSet &changes);
+    // Dead links show "!" in the vertical header and the check result as a
+    // tooltip; results for healthy links clear the flag.
+    void setLinkHealth(const QList<LinkHealth> &results);
+    int deadLinkCount() const;
+
+signals:
+    void linksChanged(const LinkChangeSet &changes);
+    void submitFinished(bool ok, const QString &errorMessage);
+    void errorOccurred(const QString &errorMessage);
+    // A page request finished, whether or not it added rows.
+    void fetchFinished();
+
+private:
+    enum class RowState : quint8 {
+        Clean,
+        Inserted,
+        Updated
+    };
+
+    // A negative limit requests every remaining row.
+    void requestPage(int limit = kPageSize);
+    void appendPage(const QList<LinkRecord> &records, int limit);
+    void clearRows();
+    void releaseStrings(int row);
+    // Copies the live strings into a fresh arena once most of it is garbage.
+    void compactStrings();
+    void markCommitted(const QList<qint64> &insertedIds);
+    int fetchedRowCount() const;
+
+    AsyncDatabase *database_ = nullptr;
+
+    QVector<qint64> ids_;
+    QVector<StringArena::Ref> titles_;
+    QVector<StringArena::Ref> sortKeys_;
+    QVector<quint32> categoryIds_;
+    QVector<StringArena::Ref> urls_;
+    QVector<RowState> states_;
+    StringArena strings_;
+    CategoryPool categories_;
+
+    QList<qint64> removedIds_;
+    // Saved inserts kept at the tail until paging reaches their ids.
+    QSet<qint64> committedTailIds_;
+    // Health of links last found dead, by id.
+    QHash<qint64, LinkHealth> deadLinks_;
+    int pendingInsertCount_ = 0;
+    qint64 lastFetchedId_ = 0;
+    bool atEnd_ = true;
+    bool fetching_ = false;
+    bool saving_ = false;
+    // Bumped by select() so pages requested before a reset are ignored.
+    int generation_ = 0;
+
+    static constexpr int kPageSize = 512;
+};
@@ -0,0 +1,196 @@
+#include "single_instance.h"
+
+#include "utilities.h"
+
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QLocalSocket>
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace {
+constexpr int kConnectTimeoutMs = 1000;
+constexpr int kWriteTimeoutMs = 5000;
+constexpr QDataStream::Version kStreamVersion = QDataStream::Qt_5_12;
+
+int expectedArgumentCount(InstanceCommand::Type type)
+{
+    return type == InstanceCommand::Type::Add ? 3 : 1;
+}
+
+// Reads "title<TAB>category<TAB>url" lines, so one launch can forward a whole batch.
+bool readAddsFromStdin(QList<InstanceCommand> *commands, QString *errorMessage)
+{
+    QTextStream in(stdin);
+    int lineNumber = 0;
+    QString line;
+    while (in.readLineInto(&line)) {
+        ++lineNumber;
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+        const auto fields = line.split('\t');
+        if (fields.size() != 3) {
+            *errorMessage = QString("stdin line %1: expected title, category and url separated by tabs.")
+                                .arg(lineNumber);
+            return false;
+        }
+        commands->append({InstanceCommand::Type::Add, fields});
+    }
+    return true;
+}
+}
+
+InstanceServer::InstanceServer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+bool InstanceServer::parseArguments(const QStringList &arguments, QList<InstanceCommand> *commands,
+                                    QString *errorMessage)
+{
+    // Plain launches may carry Qt's own options (-style, -platform, ...),
+    // which the parser below would reject.
+    const bool hasCommand = std::any_of(arguments.cbegin(), arguments.cend(), [](const QString &argument) {
+        return argument == "--add" || argument.startsWith("--open") || argument.startsWith("--import");
+    });
+    if (!hasCommand) {
+        return true;
+    }
+
+    QCommandLineParser parser;
+    QCommandLineOption addOption("add", "Add a link: <title> <category> <url>, or tab-separated lines on stdin.");
+    QCommandLineOption openOption("open", "Open the link that best matches the query.", "query");
+    QCommandLineOption importOption("import", "Import a bookmark file.", "file");
+    parser.addOption(addOption);
+    parser.addOption(openOption);
+    parser.addOption(importOption);
+    if (!parser.parse(arguments)) {
+        *errorMessage = parser.errorText();
+        return false;
+    }
+
+    const auto positional = parser.positionalArguments();
+    if (parser.isSet(addOption)) {
+        if (positional.size() == 3) {
+            commands->append({InstanceCommand::Type::Add, positional});
+        } else if (!positional.isEmpty()) {
+            *errorMessage = "--add expects <title> <category> <url>.";
+            return false;
+        } else if (!readAddsFromStdin(commands, errorMessage)) {
+            return false;
+        }
+    } else if (!positional.isEmpty()) {
+        *errorMessage = QString("Unexpected argument: %1").arg(positional.first());
+        return false;
+    }
+
+    if (parser.isSet(importOption)) {
+        // The running instance has its own working directory.
+        const auto path = QFileInfo(parser.value(importOption)).absoluteFilePath();
+        commands->append({InstanceCommand::Type::Import, {path}});
+    }
+    if (parser.isSet(openOption)) {
+        commands->append({InstanceCommand::Type::Open, {parser.value(openOption)}});
+    }
+    return true;
+}
+
+bool InstanceServer::send(const QList<InstanceCommand> &commands, QString *errorMessage)
+{
+    errorMessage->clear();
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(kConnectTimeoutMs)) {
+        // A refused connection is the socket file of an instance that crashed.
+        const auto error = socket.error();
+        if (error != QLocalSocket::ServerNotFoundError && error != QLocalSocket::ConnectionRefusedError) {
+            *errorMessage = socket.errorString();
+        }
+        return false;
+    }
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    for (const auto &command : commands) {
+        out << static_cast<quint8>(command.type) << command.arguments;
+    }
+
+    socket.write(payload);
+    while (socket.bytesToWrite() > 0) {
+        if (!socket.waitForBytesWritten(kWriteTimeoutMs)) {
+            *errorMessage = socket.errorString();
+            return false;
+        }
+    }
+    socket.disconnectFromServer();
+    if (socket.state() != QLocalSocket::UnconnectedState) {
+        socket.waitForDisconnected(kWriteTimeoutMs);
+    }
+    return true;
+}
+
+bool InstanceServer::listen(QString *errorMessage)
+{
+    const auto name = serverName();
+    QLocalServer::removeServer(name);
+    server_.setSocketOptions(QLocalServer::UserAccessOption);
+    if (!server_.listen(name)) {
+        *errorMessage = server_.errorString();
+        return false;
+    }
+
+    connect(&server_, &QLocalServer::newConnection, this, [this]() {
+        while (auto *socket = server_.nextPendingConnection()) {
+            connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readCommands(socket); });
+            connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+                readCommands(socket);
+                socket->deleteLater();
+            });
+        }
+    });
+    return true;
+}
+
+QString InstanceServer::serverName()
+{
+    // One server per user and data directory; the name must stay short
+    // because it becomes a socket path on Unix.
+    const auto key = QCryptographicHash::hash(AppPaths::appDataPath(QString()).toUtf8(), QCryptographicHash::Sha1);
+    return QString("linksdash-%1").arg(QString::fromLatin1(key.toHex().left(16)));
+}
+
+void InstanceServer::readCommands(QLocalSocket *socket)
+{
+    QDataStream in(socket);
+    in.setVersion(kStreamVersion);
+
+    QList<InstanceCommand> commands;
+    while (true) {
+        in.startTransaction();
+        quint8 type = 0;
+        QStringList arguments;
+        in >> type >> arguments;
+        if (!in.commitTransaction()) {
+            break;
+        }
+        if (type > static_cast<quint8>(InstanceCommand::Type::Import)) {
+            socket->abort();
+            break;
+        }
+
+        const InstanceCommand command{static_cast<InstanceCommand::Type>(type), arguments};
+        if (arguments.size() == expectedArgumentCount(command.type)) {
+            commands.append(command);
+        }
+    }
+
+    if (!commands.isEmpty()) {
+        emit commandsReceived(commands);
+    }
+}
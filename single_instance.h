@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QList>
+#include <QLocalServer>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QLocalSocket;
+
+// A command forwarded from a second launch to the running instance:
+//   --add <title> <category> <url>   (or tab-separated lines on stdin)
+//   --open <query>                   open the best matching link
+//   --import <file>
+struct InstanceCommand {
+    enum class Type : quint8 {
+        Add,
+        Open,
+        Import
+    };
+
+    Type type = Type::Add;
+    QStringList arguments;
+};
+
+// Runs in the first instance and receives commands from later launches over
+// a per-user QLocalServer. Clients send with send(), which needs only a
+// QCoreApplication, so a forwarding launch never builds widgets or opens
+// the database.
+class InstanceServer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit InstanceServer(QObject *parent = nullptr);
+
+    // Returns false with errorMessage set on bad usage. No commands means a
+    // normal start.
+    static bool parseArguments(const QStringList &arguments, QList<InstanceCommand> *commands,
+                               QString *errorMessage);
+    // Returns false with an empty errorMessage when no instance is listening.
+    static bool send(const QList<InstanceCommand> &commands, QString *errorMessage);
+
+    // Call only while holding the instance lock; a stale socket left by a
+    // crashed instance is removed first.
+    bool listen(QString *errorMessage);
+
+signals:
+    void commandsReceived(const QList<InstanceCommand> &commands);
+
+private:
+    static QString serverName();
+    void readCommands(QLocalSocket *socket);
+
+    QLocalServer server_;
+};
@@ -0,0 +1,245 @@
+#include "tracing.h"
+
+#include "utilities.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSettings>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace Tracing {
+    namespace {
+        const char *kTraceKey = "diagnostics/trace";
+        const char *kTraceVariable = "LINKSDASH_TRACE";
+        // Events are stored in chunks allocated as a thread records, so a
+        // thread that records a few spans costs a few KiB, not a full buffer.
+        constexpr std::size_t kChunkCapacity = 1024;
+        // Limits per thread and for the whole trace, about 1.5 MiB and 6 MiB;
+        // later spans are counted and dropped.
+        constexpr std::size_t kChunksPerThread = 64;
+        constexpr std::size_t kMaxChunks = 256;
+
+        struct Event {
+            const char *name;
+            std::int64_t startNs;
+            std::int64_t endNs;
+        };
+
+        struct Chunk {
+            Event events[kChunkCapacity];
+        };
+
+        std::atomic<std::size_t> chunkCount{0};
+
+        // Written only by the thread that holds it. A new chunk is published
+        // before count moves past its first event, and count with release
+        // ordering after the event, so write() can read [0, count) from
+        // another thread without a lock.
+        struct ThreadBuffer {
+            std::atomic<Chunk *> chunks[kChunksPerThread] = {};
+            std::atomic<std::size_t> count{0};
+            std::atomic<std::size_t> dropped{0};
+            int threadId = 0;
+            QString threadName;
+
+            ~ThreadBuffer()
+            {
+                for (auto &chunk : chunks) {
+                    delete chunk.load(std::memory_order_relaxed);
+                }
+            }
+
+            const Event &at(std::size_t index) const
+            {
+                return chunks[index / kChunkCapacity].load(std::memory_order_acquire)->events[index % kChunkCapacity];
+            }
+        };
+
+        QMutex registryMutex;
+
+        std::vector<std::shared_ptr<ThreadBuffer>> &registry()
+        {
+            static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+            return buffers;
+        }
+
+        // Buffers of exited threads, ready for the next new thread. Pool
+        // threads expire and get recreated all session long; handing their
+        // buffers on keeps the registry at the peak number of live threads.
+        std::vector<std::shared_ptr<ThreadBuffer>> &freeBuffers()
+        {
+            static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+            return buffers;
+        }
+
+        // Returns the thread's buffer to freeBuffers() when the thread exits.
+        // The buffer stays registered, so its spans are still written.
+        struct BufferLease {
+            std::shared_ptr<ThreadBuffer> buffer;
+
+            ~BufferLease()
+            {
+                if (buffer) {
+                    QMutexLocker locker(&registryMutex);
+                    freeBuffers().push_back(std::move(buffer));
+                }
+            }
+        };
+
+        ThreadBuffer &threadBuffer()
+        {
+            thread_local BufferLease lease;
+            if (!lease.buffer) {
+                auto *thread = QThread::currentThread();
+                QMutexLocker locker(&registryMutex);
+                auto &spare = freeBuffers();
+                if (!spare.empty()) {
+                    // Spans keep the name of the buffer's first thread; the
+                    // threads sharing it never overlap in time.
+                    lease.buffer = std::move(spare.back());
+                    spare.pop_back();
+                    return *lease.buffer;
+                }
+                lease.buffer = std::make_shared<ThreadBuffer>();
+                auto &buffer = *lease.buffer;
+                buffer.threadId = static_cast<int>(registry().size()) + 1;
+                buffer.threadName = thread && !thread->objectName().isEmpty()
+                    ? thread->objectName()
+                    : (thread && QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()
+                           ? QString("main")
+                           : QString("thread %1").arg(buffer.threadId));
+                registry().push_back(lease.buffer);
+            }
+            return *lease.buffer;
+        }
+
+        double microseconds(std::int64_t nanoseconds)
+        {
+            return nanoseconds / 1000.0;
+        }
+    }
+
+    bool requested(const QSettings &settings)
+    {
+        const auto variable = qgetenv(kTraceVariable);
+        if (!variable.isEmpty()) {
+            return variable != "0";
+        }
+        return settings.value(kTraceKey, false).toBool();
+    }
+
+    void setEnabled(bool enabled)
+    {
+        enabledFlag().store(enabled, std::memory_order_relaxed);
+    }
+
+    std::int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void record(const char *name, std::int64_t startNs, std::int64_t endNs)
+    {
+        auto &buffer = threadBuffer();
+        const auto index = buffer.count.load(std::memory_order_relaxed);
+        const auto chunkIndex = index / kChunkCapacity;
+        if (chunkIndex >= kChunksPerThread) {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto *chunk = buffer.chunks[chunkIndex].load(std::memory_order_relaxed);
+        if (!chunk) {
+            if (chunkCount.fetch_add(1, std::memory_order_relaxed) >= kMaxChunks) {
+                chunkCount.fetch_sub(1, std::memory_order_relaxed);
+                buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            chunk = new Chunk;
+            buffer.chunks[chunkIndex].store(chunk, std::memory_order_release);
+        }
+        chunk->events[index % kChunkCapacity] = {name, startNs, endNs};
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    bool write(const QString &path, QString *errorMessage)
+    {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            QMutexLocker locker(&registryMutex);
+            buffers = registry();
+        }
+
+        const auto pid = QCoreApplication::applicationPid();
+        QJsonArray events;
+        std::int64_t origin = -1;
+        for (const auto &buffer : buffers) {
+            const auto count = buffer->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto start = buffer->at(i).startNs;
+                origin = origin < 0 ? start : std::min(origin, start);
+            }
+        }
+
+        for (const auto &buffer : buffers) {
+            QJsonObject threadName;
+            threadName["name"] = "thread_name";
+            threadName["ph"] = "M";
+            threadName["pid"] = pid;
+            threadName["tid"] = buffer->threadId;
+            threadName["args"] = QJsonObject{{"name", buffer->threadName}};
+            events.append(threadName);
+
+            const auto count = buffer->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto &event = buffer->at(i);
+                QJsonObject span;
+                span["name"] = QString::fromUtf8(event.name);
+                span["ph"] = "X";
+                span["ts"] = microseconds(event.startNs - origin);
+                span["dur"] = microseconds(event.endNs - event.startNs);
+                span["pid"] = pid;
+                span["tid"] = buffer->threadId;
+                events.append(span);
+            }
+            const auto dropped = buffer->dropped.load(std::memory_order_relaxed);
+            if (dropped > 0) {
+                qWarning("Tracing: dropped %llu spans on %s", static_cast<unsigned long long>(dropped),
+                         qPrintable(buffer->threadName));
+            }
+        }
+
+        QJsonObject root;
+        root["traceEvents"] = events;
+        root["displayTimeUnit"] = "ms";
+
+        QDir().mkpath(QFileInfo(path).dir().path());
+        QSaveFile file(path);
+        const auto json = QJsonDocument(root).toJson(QJsonDocument::Compact);
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+            *errorMessage = file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    QString defaultPath()
+    {
+        const auto stamp = QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss");
+        return AppPaths::appDataPath(QString("trace-%1.json").arg(stamp));
+    }
+} // namespace Tracing
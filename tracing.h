@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+
+class QSettings;
+
+// Scoped timing spans for diagnosing stalls in the field, written as Chrome
+// trace JSON (chrome://tracing, ui.perfetto.dev). Off by default; set
+// LINKSDASH_TRACE=1 or the "diagnostics/trace" setting to turn it on.
+//
+// Each thread appends to a buffer of its own, so recording a span takes no
+// lock; a disabled span costs one relaxed atomic load. Buffers grow in small
+// chunks up to a fixed cap and pass to new threads when theirs exit.
+// Spans are named with string literals, which must outlive the trace.
+namespace Tracing {
+// True when the environment variable or the setting asks for tracing.
+bool requested(const QSettings &settings);
+void setEnabled(bool enabled);
+
+inline std::atomic_bool &enabledFlag()
+{
+    static std::atomic_bool enabled{false};
+    return enabled;
+}
+
+inline bool isEnabled()
+{
+    return enabledFlag().load(std::memory_order_relaxed);
+}
+
+// Monotonic nanoseconds.
+std::int64_t now();
+void record(const char *name, std::int64_t startNs, std::int64_t endNs);
+
+// Writes every span recorded so far. Call after the threads being traced
+// have finished, or their newest spans may be missing.
+bool write(const QString &path, QString *errorMessage);
+// trace-<timestamp>.json in the app data directory.
+QString defaultPath();
+
+class Span {
+public:
+    explicit Span(const char *name)
+        : name_(isEnabled() ? name : nullptr)
+        , start_(name_ ? now() : 0)
+    {
+    }
+
+    ~Span()
+    {
+        if (name_) {
+            record(name_, start_, now());
+        }
+    }
+
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+private:
+    const char *name_;
+    std::int64_t start_;
+};
+}
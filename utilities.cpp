@@ -1,7 +1,10 @@
 #include "utilities.h"
 
 #include <QDir>
+#include <QElapsedTimer>
+#include <QSet>
 #include <QStandardPaths>
+#include <QtGlobal>
 
 namespace AppPaths {
     QString appDataPath(const QString &fileName) {
@@ -11,3 +14,29 @@ namespace AppPaths {
         return finalDir;
     }
 } // namespace AppPaths
+
+namespace StartupTimer {
+    namespace {
+        QElapsedTimer &timer() {
+            static QElapsedTimer elapsed;
+            return elapsed;
+        }
+
+        QSet<QByteArray> &reported() {
+            static QSet<QByteArray> milestones;
+            return milestones;
+        }
+    }
+
+    void start() {
+        timer().start();
+    }
+
+    void mark(const char *milestone) {
+        if (!timer().isValid() || reported().contains(milestone)) {
+            return;
+        }
+        reported().insert(milestone);
+        qInfo("Startup: %s after %lld ms", milestone, static_cast<long long>(timer().elapsed()));
+    }
+} // namespace StartupTimer
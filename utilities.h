@@ -1,7 +1,32 @@
 #pragma once
 
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QObject>
 #include <QString>
 
 namespace AppPaths {
 QString appDataPath(const QString &fileName);
 }
+
+// Milestones of a single application start, logged with the time since
+// start(). Each milestone is reported once.
+namespace StartupTimer {
+void start();
+void mark(const char *milestone);
+}
+
+namespace Futures {
+// Runs callback with the future's result on context's thread once it finishes.
+// Nothing is called if context is destroyed first.
+template <typename T, typename Callback>
+void whenFinished(const QFuture<T> &future, QObject *context, Callback callback)
+{
+    auto *watcher = new QFutureWatcher<T>(context);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, context, [watcher, callback]() {
+        callback(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(future);
+}
+}
@@ -1,55 +1,122 @@
 #include "main_window.h"
 #include "ui_main_window.h"
 
+#include "../data/async_database.h"
 #include "../data/database_service.h"
+#include "../data/link_health_checker.h"
+#include "../data/link_urls.h"
+#include "../data/tray_snapshot.h"
 #include "../dialogs/link_dialog.h"
+#include "../dialogs/quick_search_dialog.h"
+#include "../dialogs/storage_settings_dialog.h"
 #include "../models/link_item.h"
-
-#include <algorithm>
+#include "../models/link_table_proxy.h"
+#include "../models/links_model.h"
+#include "../tracing.h"
+#include "../utilities.h"
+#include "tray_menu_controller.h"
 
 #include <QAction>
 #include <QApplication>
 #include <QCloseEvent>
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDesktopServices>
+#include <QFileDialog>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
 #include <QHeaderView>
-#include <QList>
-#include <QMap>
+#include <QLineEdit>
 #include <QMenu>
 #include <QMessageBox>
-#include <QPair>
+#include <QProgressDialog>
 #include <QPushButton>
-#include <QSqlError>
-#include <QSqlRecord>
-#include <QSqlTableModel>
+#include <QSettings>
+#include <QShortcut>
 #include <QStatusBar>
 #include <QStyle>
 #include <QSystemTrayIcon>
 #include <QTableView>
+#include <QTimer>
 #include <QUrl>
+#include <QtConcurrent>
+
+#include <utility>
+
+namespace {
+constexpr int kQuickSearchLimit = 20;
+constexpr int kChangePollIntervalMs = 2000;
+// Opens are written this long after the first unsaved one, or as soon as
+// the usage log is three quarters full.
+constexpr int kUsageFlushDelayMs = 5000;
+// Forwarded adds that fail to commit are retried this often before they are
+// given up.
+constexpr int kMaxInstanceAddAttempts = 3;
+constexpr int kInstanceAddRetryMs = 5000;
+// Links checked more recently than this are not probed again.
+constexpr qint64 kHealthRecheckSecs = 7 * 24 * 60 * 60;
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
-    setupUi();
-
-    QString errorMessage;
-    if (!DatabaseManager::initialize(&errorMessage)) {
-        showError("Database Error", errorMessage);
-        tableView_->setEnabled(false);
-        editButton_->setEnabled(false);
-        deleteButton_->setEnabled(false);
-        saveButton_->setEnabled(false);
-        return;
+    // The tray comes first; the widgets and the table model are built the
+    // first time the window is needed (see ensureUi()).
+    setupTray();
+    if (trayAvailable_) {
+        StartupTimer::mark("tray icon shown");
+        restoreTraySnapshot();
+    } else {
+        showWindow();
     }
 
-    setupModel();
-    setupTray();
-    refreshTrayMenu();
+    database_ = new AsyncDatabase(this);
+    Futures::whenFinished(database_->open(), this, [this](const DatabaseResult &result) {
+        if (!result.ok) {
+            databaseFailed_ = true;
+            showError("Database Error", result.errorMessage);
+            if (ui_) {
+                disableDatabaseControls();
+            }
+            if (trayController_) {
+                trayController_->setPlaceholderText("Database unavailable");
+            }
+            if (!pendingInstanceCommands_.isEmpty()) {
+                qWarning("Dropping %d forwarded commands: the database is unavailable.",
+                         static_cast<int>(pendingInstanceCommands_.size()));
+                pendingInstanceCommands_.clear();
+            }
+            return;
+        }
+
+        databaseReady_ = true;
+        StartupTimer::mark("database open");
+        if (ui_) {
+            setupModel();
+        }
+        // Read the change sequence before any rows, so writes that land
+        // during the initial load are pulled again rather than missed.
+        startChangeTracking();
+        refreshTrayMenu();
+        loadLinkHealth();
+        loadFrecency();
+        restartMaintenanceTimer();
+        handleInstanceCommands(std::exchange(pendingInstanceCommands_, {}));
+    });
 }
 
 MainWindow::~MainWindow()
 {
+    if (healthChecker_) {
+        healthChecker_->cancel();
+    }
+    // Queued before the worker shuts down, so the last opens are kept.
+    flushUsage();
+    // Closing the last connection checkpoints the WAL, so the snapshot is
+    // stamped with the files as the next start will find them.
+    delete database_;
+    database_ = nullptr;
+    saveTraySnapshot();
     delete ui_;
 }
 
@@ -75,15 +142,61 @@ void MainWindow::closeEvent(QCloseEvent *event)
     trayNoticeShown_ = true;
 }
 
+void MainWindow::ensureUi()
+{
+    if (ui_) {
+        return;
+    }
+
+    setupUi();
+    if (databaseReady_) {
+        setupModel();
+        loadLinkHealth();
+    } else if (databaseFailed_) {
+        disableDatabaseControls();
+    }
+    StartupTimer::mark("main window built");
+}
+
+void MainWindow::showWindow()
+{
+    ensureUi();
+    show();
+    raise();
+    activateWindow();
+    if (toggleWindowAction_) {
+        toggleWindowAction_->setText("Hide LinksDash");
+    }
+}
+
+void MainWindow::disableDatabaseControls()
+{
+    searchLineEdit_->setEnabled(false);
+    tableView_->setEnabled(false);
+    editButton_->setEnabled(false);
+    deleteButton_->setEnabled(false);
+    importButton_->setEnabled(false);
+    exportButton_->setEnabled(false);
+    backupButton_->setEnabled(false);
+    checkLinksButton_->setEnabled(false);
+    saveButton_->setEnabled(false);
+}
+
 void MainWindow::setupUi()
 {
     ui_ = new Ui::MainWindow;
     ui_->setupUi(this);
 
+    searchLineEdit_ = ui_->searchLineEdit;
     tableView_ = ui_->tableView;
     addButton_ = ui_->addButton;
     editButton_ = ui_->editButton;
     deleteButton_ = ui_->deleteButton;
+    importButton_ = ui_->importButton;
+    exportButton_ = ui_->exportButton;
+    backupButton_ = ui_->backupButton;
+    checkLinksButton_ = ui_->checkLinksButton;
+    settingsButton_ = ui_->settingsButton;
     saveButton_ = ui_->saveButton;
 
     tableView_->setSelectionBehavior(QAbstractItemView::SelectRows);
@@ -91,63 +204,58 @@ void MainWindow::setupUi()
     tableView_->setEditTriggers(QAbstractItemView::NoEditTriggers);
     tableView_->setAlternatingRowColors(true);
 
+    searchLineEdit_->setPlaceholderText("Filter links (category:name, host:example.com)");
+    connect(searchLineEdit_, &QLineEdit::textChanged, this, &MainWindow::handleSearchTextChanged);
+
     connect(addButton_, &QPushButton::clicked, this, &MainWindow::handleAdd);
     editButton_->setToolTip("Edit the selected link.");
     connect(editButton_, &QPushButton::clicked, this, &MainWindow::handleEdit);
     connect(deleteButton_, &QPushButton::clicked, this, &MainWindow::handleDelete);
+    importButton_->setToolTip("Import bookmarks from an HTML, CSV or JSON file.");
+    connect(importButton_, &QPushButton::clicked, this, &MainWindow::handleImport);
+    exportButton_->setToolTip("Export saved links as CSV, JSON or bookmark HTML.");
+    connect(exportButton_, &QPushButton::clicked, this, &MainWindow::handleExport);
+    backupButton_->setToolTip("Write a copy of the database file.");
+    connect(backupButton_, &QPushButton::clicked, this, &MainWindow::handleBackup);
+    checkLinksButton_->setToolTip("Probe every link not checked in the last week and flag dead ones.");
+    connect(checkLinksButton_, &QPushButton::clicked, this, &MainWindow::handleCheckLinks);
+    settingsButton_->setToolTip("Tune how the database is stored and synced.");
+    connect(settingsButton_, &QPushButton::clicked, this, &MainWindow::handleStorageSettings);
     connect(saveButton_, &QPushButton::clicked, this, &MainWindow::handleSave);
 
+    auto *quickSearchShortcut = new QShortcut(QKeySequence("Ctrl+K"), this);
+    quickSearchShortcut->setContext(Qt::ApplicationShortcut);
+    connect(quickSearchShortcut, &QShortcut::activated, this, &MainWindow::showQuickSearch);
+
+    updateButtonStates();
     statusBar()->showMessage("Ready.");
 }
 
 void MainWindow::setupModel()
 {
-    auto db = DatabaseManager::database();
-    if (!db.isValid()) {
-        showError("Database Error", "Database connection is invalid.");
-        return;
-    }
-
-    model_ = new QSqlTableModel(this, db);
-    model_->setTable("links");
-    model_->setEditStrategy(QSqlTableModel::OnManualSubmit);
-
-    if (!model_->select()) {
-        showError("Database Error", model_->lastError().text());
-        return;
-    }
-
-    tableView_->setModel(model_);
-
-    const int idColumn = model_->fieldIndex("id");
-    if (idColumn >= 0) {
-        tableView_->hideColumn(idColumn);
+    model_ = new LinksModel(database_, this);
+    connect(model_, &LinksModel::errorOccurred, this, [this](const QString &message) {
+        showError("Database Error", message);
+    });
+    connect(model_, &LinksModel::submitFinished, this, &MainWindow::handleSaveFinished);
+    if (trayController_) {
+        connect(model_, &LinksModel::linksChanged, trayController_, &TrayMenuController::apply);
     }
+    connect(model_, &LinksModel::linksChanged, this, &MainWindow::applyFuzzyChanges);
+    connect(model_, &LinksModel::linksChanged, this, &MainWindow::applyFrecencyChanges);
 
-    const int titleColumn = model_->fieldIndex("title");
-    const int categoryColumn = model_->fieldIndex("category");
-    const int urlColumn = model_->fieldIndex("url");
-
-    if (titleColumn >= 0) {
-        model_->setHeaderData(titleColumn, Qt::Horizontal, "Title");
-    }
-    if (categoryColumn >= 0) {
-        model_->setHeaderData(categoryColumn, Qt::Horizontal, "Category");
-    }
-    if (urlColumn >= 0) {
-        model_->setHeaderData(urlColumn, Qt::Horizontal, "URL");
-    }
+    // Filtering and sorting run off the GUI thread; the view only sees the
+    // resulting row order.
+    proxy_ = new LinkTableProxy(model_, this);
+    tableView_->setModel(proxy_);
     tableView_->horizontalHeader()->setStretchLastSection(true);
     tableView_->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    tableView_->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    tableView_->setSortingEnabled(true);
 
     connect(tableView_->selectionModel(), &QItemSelectionModel::selectionChanged, this, &MainWindow::updateButtonStates);
-    connect(model_, &QSqlTableModel::dataChanged, this,
-            [this](const auto &, const auto &, const auto &) { markPendingChanges(); });
-    connect(model_, &QSqlTableModel::rowsInserted, this,
-            [this](const QModelIndex &, int, int) { markPendingChanges(); });
-    connect(model_, &QSqlTableModel::rowsRemoved, this,
-            [this](const QModelIndex &, int, int) { markPendingChanges(); });
 
+    model_->select();
     updateButtonStates();
 }
 
@@ -174,96 +282,232 @@ void MainWindow::setupTray()
 
     trayMenu_ = new QMenu(this);
 
+    quickSearchAction_ = trayMenu_->addAction("Search Links...");
+    connect(quickSearchAction_, &QAction::triggered, this, &MainWindow::showQuickSearch);
+
+    toggleWindowAction_ = trayMenu_->addAction(isVisible() ? "Hide LinksDash" : "Configure");
+    connect(toggleWindowAction_, &QAction::triggered, this, [this]() {
+        if (isVisible()) {
+            hide();
+            toggleWindowAction_->setText("Configure");
+            return;
+        }
+        showWindow();
+    });
+
+    addLinkAction_ = trayMenu_->addAction("Add Link...");
+    connect(addLinkAction_, &QAction::triggered, this, &MainWindow::handleAddFromTray);
+
+    quitAction_ = trayMenu_->addAction("Quit");
+    connect(quitAction_, &QAction::triggered, this, [this]() { qApp->quit(); });
+
+    trayController_ = new TrayMenuController(trayMenu_, this);
+    trayController_->setFooterAnchor(quickSearchAction_);
+    connect(trayController_, &TrayMenuController::linkTriggered, this, &MainWindow::openUrl);
+
     trayIcon_->setContextMenu(trayMenu_);
     trayIcon_->show();
 }
 
-void MainWindow::refreshTrayMenu()
+void MainWindow::restoreTraySnapshot()
 {
-    if (!trayMenu_) {
+    const auto databasePath = DatabaseManager::databaseFilePath();
+    auto snapshot = std::make_shared<TraySnapshot>();
+    QString errorMessage;
+    if (!snapshot->open(TraySnapshot::pathFor(databasePath), &errorMessage)) {
+        if (!errorMessage.isEmpty()) {
+            qWarning("%s", qPrintable(errorMessage));
+        }
         return;
     }
 
-    trayMenu_->clear();
-    toggleWindowAction_ = nullptr;
-    addLinkAction_ = nullptr;
-    quitAction_ = nullptr;
+    traySnapshotStamp_ = snapshot->stamp();
+    traySnapshotFresh_ = traySnapshotStamp_ == TraySnapshot::databaseStamp(databasePath);
+    trayController_->restore(snapshot);
+    StartupTimer::mark("tray menu ready");
+}
 
-    if (!model_) {
-        QAction *disabled = trayMenu_->addAction("Database unavailable");
-        disabled->setEnabled(false);
-    } else {
-        const int titleColumn = model_->fieldIndex("title");
-        const int categoryColumn = model_->fieldIndex("category");
-        const int urlColumn = model_->fieldIndex("url");
+void MainWindow::saveTraySnapshot()
+{
+    if (!trayController_ || !trayController_->hasGroups()) {
+        return;
+    }
 
-        if (titleColumn < 0 || categoryColumn < 0 || urlColumn < 0) {
-            QAction *disabled = trayMenu_->addAction("Schema error");
-            disabled->setEnabled(false);
-        } else {
-            QMap<QString, QList<QPair<QString, QString>>> byCategory;
-            for (int row = 0; row < model_->rowCount(); ++row) {
-                const auto title = model_->data(model_->index(row, titleColumn)).toString().trimmed();
-                const auto rawCategory = model_->data(model_->index(row, categoryColumn)).toString().trimmed();
-                const auto url = model_->data(model_->index(row, urlColumn)).toString().trimmed();
-
-                if (title.isEmpty() || url.isEmpty()) {
-                    continue;
-                }
+    // Unchanged files mean the snapshot on disk was fresh and still is.
+    const auto databasePath = DatabaseManager::databaseFilePath();
+    const auto stamp = TraySnapshot::databaseStamp(databasePath);
+    if (stamp.isEmpty() || stamp == traySnapshotStamp_) {
+        return;
+    }
 
-                const auto category = rawCategory.isEmpty() ? QString("Uncategorized") : rawCategory;
-                byCategory[category].append({title, url});
-            }
+    QString errorMessage;
+    if (!TraySnapshot::write(TraySnapshot::pathFor(databasePath), trayController_->groups(), stamp, &errorMessage)) {
+        qWarning("Unable to write the tray snapshot: %s", qPrintable(errorMessage));
+    }
+}
 
-            if (byCategory.isEmpty()) {
-                QAction *emptyAction = trayMenu_->addAction("No links yet");
-                emptyAction->setEnabled(false);
-            } else {
-                bool firstCategory = true;
-                for (auto it = byCategory.cbegin(); it != byCategory.cend(); ++it) {
-                    if (!firstCategory) {
-                        trayMenu_->addSeparator();
-                    }
-                    firstCategory = false;
-
-                    QAction *categoryHeader = trayMenu_->addAction(it.key());
-                    categoryHeader->setEnabled(false);
-
-                    auto entries = it.value();
-                    std::sort(entries.begin(), entries.end(), [](const auto &left, const auto &right) {
-                        return left.first.toLower() < right.first.toLower();
-                    });
-
-                    for (const auto &entry : entries) {
-                        QAction *action = trayMenu_->addAction(entry.first);
-                        const auto url = entry.second;
-                        connect(action, &QAction::triggered, this, [this, url]() { openUrl(url); });
-                    }
-                }
+void MainWindow::refreshTrayMenu()
+{
+    const Tracing::Span span("MainWindow::refreshTrayMenu");
+    if (!database_) {
+        return;
+    }
+
+    // A fresh snapshot already holds the sorted groups; load them off the
+    // GUI thread instead of querying and regrouping every link.
+    const auto snapshot = trayController_ ? trayController_->snapshot() : nullptr;
+    if (snapshot && traySnapshotFresh_) {
+        traySnapshotFresh_ = false;
+        const auto future = QtConcurrent::run([snapshot]() {
+            LinkGroups groups;
+            groups.restore(*snapshot);
+            return groups;
+        });
+        Futures::whenFinished(future, this, [this](const LinkGroups &groups) {
+            const Tracing::Span span("TrayMenuController::setGroups");
+            trayController_->setGroups(groups);
+        });
+        return;
+    }
+
+    // Reads the sequence before the rows on the same worker, so nothing
+    // committed in between can be missed; at worst it is applied twice.
+    if (changeSequence_ >= 0) {
+        Futures::whenFinished(database_->changesSince(-1), this, [this](const LinkChangesResult &result) {
+            if (result.ok) {
+                changeSequence_ = qMax(changeSequence_, result.sequence);
             }
+        });
+    }
+    Futures::whenFinished(database_->loadAll(), this, [this](const LinkQueryResult &result) {
+        if (!result.ok) {
+            showError("Database Error", result.errorMessage);
+            return;
+        }
+        if (trayController_) {
+            const Tracing::Span span("TrayMenuController::reset");
+            trayController_->reset(result.records);
+            StartupTimer::mark("tray menu ready");
+        }
+        rebuildFuzzyIndex(result.records);
+    });
+}
+
+void MainWindow::startChangeTracking()
+{
+    Futures::whenFinished(database_->changesSince(-1), this, [this](const LinkChangesResult &result) {
+        if (!result.ok) {
+            qWarning("Change tracking unavailable: %s", qPrintable(result.errorMessage));
+            return;
+        }
+        changeSequence_ = qMax(changeSequence_, result.sequence);
+
+        // data_version polling catches every writer; the watcher only makes
+        // writes that touch the files show up sooner.
+        changePollTimer_ = new QTimer(this);
+        connect(changePollTimer_, &QTimer::timeout, this, &MainWindow::pollExternalChanges);
+        changePollTimer_->start(kChangePollIntervalMs);
+
+        databaseWatcher_ = new QFileSystemWatcher(this);
+        connect(databaseWatcher_, &QFileSystemWatcher::fileChanged, this, [this]() {
+            watchDatabaseFiles();
+            pollExternalChanges();
+        });
+        watchDatabaseFiles();
+    });
+}
+
+void MainWindow::watchDatabaseFiles()
+{
+    // The WAL file comes and goes with checkpoints, so re-add it when it exists.
+    const auto databasePath = DatabaseManager::databaseFilePath();
+    for (const auto &path : {databasePath, databasePath + "-wal"}) {
+        if (!databaseWatcher_->files().contains(path) && QFileInfo::exists(path)) {
+            databaseWatcher_->addPath(path);
         }
     }
+}
 
-    trayMenu_->addSeparator();
+void MainWindow::pollExternalChanges()
+{
+    if (pollingChanges_ || changeSequence_ < 0) {
+        return;
+    }
 
-    toggleWindowAction_ = trayMenu_->addAction(isVisible() ? "Hide LinksDash" : "Configure");
-    connect(toggleWindowAction_, &QAction::triggered, this, [this]() {
-        if (isVisible()) {
-            hide();
-            toggleWindowAction_->setText("Configure");
+    pollingChanges_ = true;
+    Futures::whenFinished(database_->pollChanges(changeSequence_), this, [this](const LinkChangesResult &result) {
+        pollingChanges_ = false;
+        if (!result.ok) {
+            qWarning("Unable to read external changes: %s", qPrintable(result.errorMessage));
             return;
         }
-        show();
-        raise();
-        activateWindow();
-        toggleWindowAction_->setText("Hide LinksDash");
+        changeSequence_ = qMax(changeSequence_, result.sequence);
+        if (result.changes.isEmpty()) {
+            return;
+        }
+
+        // The log also holds this window's own saves since the last poll;
+        // applying those again leaves every view unchanged.
+        if (model_) {
+            model_->mergeChanges(result.changes);
+        }
+        if (trayController_) {
+            trayController_->apply(result.changes);
+        }
+        applyFuzzyChanges(result.changes);
+        applyFrecencyChanges(result.changes);
+        if (ui_) {
+            statusBar()->showMessage(QString("Loaded %1 changes made outside LinksDash.").arg(result.changes.size()), 3000);
+        }
     });
+}
 
-    addLinkAction_ = trayMenu_->addAction("Add Link...");
-    connect(addLinkAction_, &QAction::triggered, this, &MainWindow::handleAddFromTray);
+void MainWindow::ensureFuzzyIndex()
+{
+    if (fuzzyIndexRequested_ || !databaseReady_) {
+        return;
+    }
 
-    quitAction_ = trayMenu_->addAction("Quit");
-    connect(quitAction_, &QAction::triggered, this, [this]() { qApp->quit(); });
+    fuzzyIndexRequested_ = true;
+    Futures::whenFinished(database_->loadAll(), this, [this](const LinkQueryResult &result) {
+        if (!result.ok) {
+            fuzzyIndexRequested_ = false;
+            return;
+        }
+        rebuildFuzzyIndex(result.records);
+    });
+}
+
+void MainWindow::rebuildFuzzyIndex(const QList<LinkRecord> &records)
+{
+    fuzzyIndexRequested_ = true;
+    fuzzyIndexReady_ = false;
+    const auto future = QtConcurrent::run([records]() {
+        FuzzyIndex index;
+        index.build(records);
+        return index;
+    });
+    Futures::whenFinished(future, this, [this](const FuzzyIndex &index) {
+        fuzzyIndex_ = index;
+        for (const auto &changes : std::as_const(pendingFuzzyChanges_)) {
+            fuzzyIndex_.apply(changes);
+        }
+        pendingFuzzyChanges_.clear();
+        fuzzyIndexReady_ = true;
+    });
+}
+
+void MainWindow::applyFuzzyChanges(const LinkChangeSet &changes)
+{
+    // Until the index is requested, a later build reads these rows anyway.
+    if (!fuzzyIndexRequested_) {
+        return;
+    }
+    if (!fuzzyIndexReady_) {
+        pendingFuzzyChanges_.append(changes);
+        return;
+    }
+    fuzzyIndex_.apply(changes);
 }
 
 void MainWindow::updateButtonStates()
@@ -275,7 +519,7 @@ void MainWindow::updateButtonStates()
 
 void MainWindow::handleEdit()
 {
-    if (!model_) {
+    if (!model_ || model_->isSaving()) {
         return;
     }
 
@@ -289,7 +533,7 @@ void MainWindow::handleEdit()
 
 void MainWindow::handleAdd()
 {
-    if (!model_) {
+    if (!model_ || model_->isSaving()) {
         return;
     }
 
@@ -298,7 +542,7 @@ void MainWindow::handleAdd()
 
 void MainWindow::handleDelete()
 {
-    if (!model_) {
+    if (!model_ || model_->isSaving()) {
         return;
     }
 
@@ -312,8 +556,7 @@ void MainWindow::handleDelete()
         return;
     }
 
-    if (!model_->removeRow(row)) {
-        showError("Database Error", model_->lastError().text());
+    if (!model_->removeLink(row)) {
         return;
     }
 
@@ -321,49 +564,458 @@ void MainWindow::handleDelete()
 }
 
 void MainWindow::handleSave()
+{
+    const Tracing::Span span("MainWindow::handleSave");
+    if (!model_ || model_->isSaving()) {
+        return;
+    }
+
+    saveButton_->setEnabled(false);
+    statusBar()->showMessage("Saving...");
+    model_->submitAll();
+}
+
+void MainWindow::handleSaveFinished(bool ok, const QString &errorMessage)
+{
+    saveButton_->setEnabled(true);
+    if (!ok) {
+        statusBar()->clearMessage();
+        showError("Save Failed", errorMessage);
+    } else {
+        statusBar()->showMessage("Saved.", 3000);
+    }
+
+    for (const auto &edit : std::exchange(deferredEdits_, {})) {
+        applyLinkEdit(edit.row, edit.id, edit.link);
+    }
+}
+
+void MainWindow::handleImport()
+{
+    if (!model_ || model_->isSaving()) {
+        return;
+    }
+
+    if (model_->hasPendingChanges()) {
+        QMessageBox::information(this, "Import Links", "Save pending changes before importing.");
+        return;
+    }
+
+    const auto path = QFileDialog::getOpenFileName(this, "Import Links", QString(),
+                                                   "Bookmarks (*.html *.htm *.csv *.json);;All files (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    startImport(path);
+}
+
+void MainWindow::startImport(const QString &path)
+{
+    if (!model_ || model_->isSaving() || !importButton_->isEnabled()) {
+        statusBar()->showMessage("Busy; import not started.", 5000);
+        return;
+    }
+    if (model_->hasPendingChanges()) {
+        QMessageBox::information(this, "Import Links", "Save pending changes before importing.");
+        return;
+    }
+
+    auto *progress = new QProgressDialog("Importing links...", "Cancel", 0, 1000, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(0);
+    progress->setAutoClose(false);
+    connect(progress, &QProgressDialog::canceled, database_, &AsyncDatabase::cancelImport);
+    connect(database_, &AsyncDatabase::importProgress, progress,
+            [progress](qint64 bytesRead, qint64 totalBytes, qint64 imported) {
+        progress->setLabelText(QString("Imported %1 links...").arg(imported));
+        if (totalBytes > 0) {
+            progress->setValue(static_cast<int>(qMin<qint64>(bytesRead * 1000 / totalBytes, 999)));
+        }
+    });
+
+    importButton_->setEnabled(false);
+    Futures::whenFinished(database_->importFile(path), this, [this, progress](const ImportResult &result) {
+        progress->deleteLater();
+        importButton_->setEnabled(true);
+
+        if (!result.ok) {
+            showError("Import Failed", result.errorMessage);
+        }
+
+        auto message = QString("Imported %1 links").arg(result.imported);
+        if (result.skipped > 0) {
+            message += QString(", skipped %1 without a URL").arg(result.skipped);
+        }
+        if (result.duplicates > 0) {
+            message += QString(", skipped %1 already saved").arg(result.duplicates);
+        }
+        if (result.cancelled) {
+            message += " before cancelling";
+        }
+        statusBar()->showMessage(message + ".", 5000);
+
+        if (result.imported > 0) {
+            model_->select();
+            refreshTrayMenu();
+        }
+    });
+}
+
+void MainWindow::handleInstanceCommands(const QList<InstanceCommand> &commands)
+{
+    if (!databaseReady_) {
+        if (!databaseFailed_) {
+            pendingInstanceCommands_ += commands;
+        }
+        return;
+    }
+
+    for (const auto &command : commands) {
+        const auto &arguments = command.arguments;
+        if (command.type == InstanceCommand::Type::Add) {
+            LinkItem link{arguments.at(0).trimmed(), arguments.at(1).trimmed(), arguments.at(2).trimmed()};
+            if (link.url.isEmpty()) {
+                continue;
+            }
+            if (link.title.isEmpty()) {
+                link.title = link.url;
+            }
+            pendingAdds_.append(link);
+            continue;
+        }
+
+        // Keep the order the commands were given in.
+        commitInstanceAdds();
+        if (command.type == InstanceCommand::Type::Open) {
+            openBestMatch(arguments.at(0));
+        } else {
+            showWindow();
+            startImport(arguments.at(0));
+        }
+    }
+    commitInstanceAdds();
+}
+
+void MainWindow::commitInstanceAdds()
+{
+    // Adds that arrive while a commit is running are sent together with the
+    // next one, so a flood of small commands becomes a few large transactions.
+    if (committingAdds_ || pendingAdds_.isEmpty()) {
+        return;
+    }
+
+    LinkBatch batch;
+    batch.inserted = std::exchange(pendingAdds_, {});
+    committingAdds_ = true;
+    Futures::whenFinished(database_->commit(batch), this, [this, batch](const LinkBatchResult &result) {
+        committingAdds_ = false;
+        if (!result.ok) {
+            handleInstanceAddsFailed(batch.inserted, result.errorMessage);
+            return;
+        }
+
+        failedAddAttempts_ = 0;
+        LinkChangeSet changes;
+        for (int i = 0; i < batch.inserted.size() && i < result.insertedIds.size(); ++i) {
+            changes.inserted.append({result.insertedIds.at(i), batch.inserted.at(i)});
+        }
+        if (model_) {
+            model_->mergeChanges(changes);
+        }
+        if (trayController_) {
+            trayController_->apply(changes);
+        }
+        applyFuzzyChanges(changes);
+        commitInstanceAdds();
+    });
+}
+
+void MainWindow::handleInstanceAddsFailed(const QList<LinkItem> &links, const QString &errorMessage)
+{
+    qWarning("Unable to add forwarded links: %s", qPrintable(errorMessage));
+    // The launch that sent them has already exited, so this is the only
+    // place the failure can show. Failed links go back in front of any that
+    // arrived meanwhile and are retried a few times.
+    pendingAdds_ = links + pendingAdds_;
+    QString message;
+    if (++failedAddAttempts_ < kMaxInstanceAddAttempts) {
+        message = QString("Could not add %1 link(s); retrying. %2").arg(links.size()).arg(errorMessage);
+        QTimer::singleShot(kInstanceAddRetryMs, this, &MainWindow::commitInstanceAdds);
+    } else {
+        message = QString("Could not add %1 link(s): %2").arg(pendingAdds_.size()).arg(errorMessage);
+        pendingAdds_.clear();
+        failedAddAttempts_ = 0;
+    }
+
+    if (trayAvailable_ && trayIcon_) {
+        trayIcon_->showMessage("LinksDash", message, QSystemTrayIcon::Warning);
+    } else {
+        statusBar()->showMessage(message, 10000);
+    }
+}
+
+void MainWindow::openBestMatch(const QString &query)
+{
+    const auto openFirst = [this, query](const QList<LinkRecord> &records) {
+        if (!records.isEmpty()) {
+            openUrl(records.first().id, records.first().link.url);
+        } else if (trayIcon_) {
+            trayIcon_->showMessage("LinksDash", QString("No link matches \"%1\".").arg(query));
+        }
+    };
+
+    if (fuzzyIndexReady_) {
+        openFirst(fuzzyIndex_.search(query, 1));
+        return;
+    }
+    Futures::whenFinished(database_->search(query, 1), this, [openFirst](const LinkQueryResult &result) {
+        openFirst(result.records);
+    });
+}
+
+void MainWindow::handleExport()
 {
     if (!model_) {
         return;
     }
 
-    auto db = model_->database();
-    if (!db.isValid()) {
-        showError("Database Error", "Database connection is invalid.");
+    const auto csvFilter = QStringLiteral("CSV (*.csv)");
+    const auto jsonFilter = QStringLiteral("JSON (*.json)");
+    const auto htmlFilter = QStringLiteral("Bookmarks HTML (*.html)");
+    QString selectedFilter = csvFilter;
+    auto path = QFileDialog::getSaveFileName(this, "Export Links", "links.csv",
+                                             QStringList{csvFilter, jsonFilter, htmlFilter}.join(";;"),
+                                             &selectedFilter);
+    if (path.isEmpty()) {
         return;
     }
+    if (QFileInfo(path).suffix().isEmpty()) {
+        path += selectedFilter == jsonFilter ? ".json" : selectedFilter == htmlFilter ? ".html" : ".csv";
+    }
+
+    auto *progress = new QProgressDialog("Exporting links...", "Cancel", 0, 1000, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(500);
+    progress->setAutoClose(false);
+    connect(progress, &QProgressDialog::canceled, database_, &AsyncDatabase::cancelExport);
+    connect(database_, &AsyncDatabase::exportProgress, progress, [progress](qint64 exported, qint64 total) {
+        progress->setLabelText(QString("Exported %1 links...").arg(exported));
+        if (total > 0) {
+            progress->setValue(static_cast<int>(qMin<qint64>(exported * 1000 / total, 999)));
+        }
+    });
+
+    exportButton_->setEnabled(false);
+    const auto format = LinkExporter::formatForPath(path);
+    Futures::whenFinished(database_->exportFile(path, format), this, [this, progress, path](const ExportResult &result) {
+        progress->deleteLater();
+        exportButton_->setEnabled(true);
+
+        if (!result.ok) {
+            showError("Export Failed", result.errorMessage);
+            return;
+        }
+        if (result.cancelled) {
+            statusBar()->showMessage("Export cancelled.", 5000);
+            return;
+        }
+
+        auto message = QString("Exported %1 links to %2").arg(result.exported).arg(QFileInfo(path).fileName());
+        if (model_->hasPendingChanges()) {
+            message += " (unsaved changes not included)";
+        }
+        statusBar()->showMessage(message + ".", 5000);
+    });
+}
+
+void MainWindow::handleBackup()
+{
+    const auto path = QFileDialog::getSaveFileName(this, "Back Up Database", "linksdash-backup.sqlite",
+                                                   "SQLite database (*.sqlite *.db);;All files (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    backupButton_->setEnabled(false);
+    statusBar()->showMessage("Backing up database...");
+    Futures::whenFinished(database_->backup(path), this, [this, path](const DatabaseResult &result) {
+        backupButton_->setEnabled(true);
+        if (!result.ok) {
+            statusBar()->clearMessage();
+            showError("Backup Failed", result.errorMessage);
+            return;
+        }
+        statusBar()->showMessage(QString("Database backed up to %1.").arg(QFileInfo(path).fileName()), 5000);
+    });
+}
+
+void MainWindow::handleCheckLinks()
+{
+    if (!databaseReady_) {
+        return;
+    }
+    if (healthChecker_ && healthChecker_->isRunning()) {
+        healthChecker_->cancel();
+        return;
+    }
+
+    if (!healthChecker_) {
+        healthChecker_ = new LinkHealthChecker(this);
+        connect(healthChecker_, &LinkHealthChecker::checked, this, &MainWindow::handleHealthResults);
+        connect(healthChecker_, &LinkHealthChecker::progress, this, [this](int done, int total) {
+            statusBar()->showMessage(QString("Checking links: %1 of %2...").arg(done).arg(total));
+        });
+        connect(healthChecker_, &LinkHealthChecker::finished, this, [this](bool cancelled) {
+            checkLinksButton_->setText("Check Links");
+            const int dead = model_ ? model_->deadLinkCount() : 0;
+            statusBar()->showMessage(QString("Link check %1: %2 dead links.")
+                                         .arg(cancelled ? "stopped" : "finished")
+                                         .arg(dead),
+                                     5000);
+        });
+    }
+
+    checkLinksButton_->setEnabled(false);
+    const qint64 checkedBefore = QDateTime::currentSecsSinceEpoch() - kHealthRecheckSecs;
+    Futures::whenFinished(database_->healthTargets(checkedBefore), this, [this](const LinkQueryResult &result) {
+        checkLinksButton_->setEnabled(true);
+        if (!result.ok) {
+            showError("Database Error", result.errorMessage);
+            return;
+        }
+        if (result.records.isEmpty()) {
+            statusBar()->showMessage("Every link was checked in the last week.", 5000);
+            return;
+        }
+        checkLinksButton_->setText("Stop Checking");
+        healthChecker_->start(result.records);
+    });
+}
+
+void MainWindow::handleHealthResults(const QList<LinkHealth> &results)
+{
+    Futures::whenFinished(database_->saveHealth(results), this, [](const DatabaseResult &result) {
+        if (!result.ok) {
+            qWarning("Unable to save link check results: %s", qPrintable(result.errorMessage));
+        }
+    });
+    if (model_) {
+        model_->setLinkHealth(results);
+    }
+    if (trayController_) {
+        trayController_->setLinkHealth(results);
+    }
+}
+
+void MainWindow::loadLinkHealth()
+{
+    Futures::whenFinished(database_->loadHealth(), this, [this](const LinkHealthResult &result) {
+        if (!result.ok) {
+            qWarning("Unable to load link check results: %s", qPrintable(result.errorMessage));
+            return;
+        }
+        if (model_) {
+            model_->setLinkHealth(result.results);
+        }
+        if (trayController_) {
+            trayController_->setLinkHealth(result.results);
+        }
+    });
+}
 
-    if (!db.transaction()) {
-        showError("Database Error", db.lastError().text());
+void MainWindow::handleStorageSettings()
+{
+    StorageSettingsDialog dialog(this);
+    dialog.setProfile(DatabaseManager::storageProfile());
+    if (dialog.exec() != QDialog::Accepted) {
         return;
     }
 
-    if (!model_->submitAll()) {
-        db.rollback();
-        showError("Save Failed", model_->lastError().text());
+    const auto profile = dialog.profile();
+    QSettings settings;
+    profile.save(settings);
+    DatabaseManager::setStorageProfile(profile);
+    restartMaintenanceTimer();
+
+    if (!databaseReady_) {
         return;
     }
+    Futures::whenFinished(database_->applyStorageProfile(), this, [this](const DatabaseResult &result) {
+        if (!result.ok) {
+            showError("Storage Settings", result.errorMessage);
+            return;
+        }
+        statusBar()->showMessage("Storage settings applied.", 3000);
+    });
+}
 
-    if (!db.commit()) {
-        db.rollback();
-        showError("Save Failed", db.lastError().text());
+void MainWindow::restartMaintenanceTimer()
+{
+    const int minutes = DatabaseManager::storageProfile().maintenanceIntervalMinutes;
+    if (minutes <= 0 || !databaseReady_) {
+        if (maintenanceTimer_) {
+            maintenanceTimer_->stop();
+        }
         return;
     }
 
-    model_->select();
-    refreshTrayMenu();
-    statusBar()->showMessage("Saved.", 3000);
+    if (!maintenanceTimer_) {
+        maintenanceTimer_ = new QTimer(this);
+        connect(maintenanceTimer_, &QTimer::timeout, this, [this]() {
+            Futures::whenFinished(database_->runMaintenance(), this, [](const DatabaseResult &result) {
+                if (!result.ok) {
+                    qWarning("%s", qPrintable(result.errorMessage));
+                }
+            });
+        });
+    }
+    maintenanceTimer_->start(minutes * 60 * 1000);
 }
 
 void MainWindow::handleAddFromTray()
 {
-    if (!isVisible()) {
-        show();
-    }
-    raise();
-    activateWindow();
+    showWindow();
     handleAdd();
 }
 
+void MainWindow::handleSearchTextChanged(const QString &text)
+{
+    if (!proxy_) {
+        return;
+    }
+    proxy_->setFilterText(text);
+}
+
+void MainWindow::showQuickSearch()
+{
+    if (!quickSearchDialog_) {
+        quickSearchDialog_ = new QuickSearchDialog(this);
+        connect(quickSearchDialog_, &QuickSearchDialog::queryChanged, this, &MainWindow::runQuickSearch);
+        connect(quickSearchDialog_, &QuickSearchDialog::linkActivated, this, &MainWindow::openUrl);
+    }
+    ensureFuzzyIndex();
+    quickSearchDialog_->activate();
+}
+
+void MainWindow::runQuickSearch(const QString &query)
+{
+    if (!databaseReady_) {
+        return;
+    }
+
+    if (fuzzyIndexReady_) {
+        quickSearchDialog_->setResults(query, fuzzyIndex_.search(query, kQuickSearchLimit));
+        return;
+    }
+
+    // The in-memory index is still building; fall back to the FTS index.
+    Futures::whenFinished(database_->search(query, kQuickSearchLimit), this,
+                          [this, query](const LinkQueryResult &result) {
+        quickSearchDialog_->setResults(query, result.records);
+    });
+}
+
 int MainWindow::selectedRow() const
 {
     if (!tableView_ || !tableView_->selectionModel()) {
@@ -371,11 +1023,12 @@ int MainWindow::selectedRow() const
     }
 
     const auto rows = tableView_->selectionModel()->selectedRows();
-    if (rows.isEmpty()) {
+    if (rows.isEmpty() || !proxy_) {
         return -1;
     }
 
-    return rows.first().row();
+    // Callers work with model rows.
+    return proxy_->mapToSource(rows.first()).row();
 }
 
 void MainWindow::openLinkDialog(int row)
@@ -384,24 +1037,10 @@ void MainWindow::openLinkDialog(int row)
         return;
     }
 
-    const int titleColumn = model_->fieldIndex("title");
-    const int categoryColumn = model_->fieldIndex("category");
-    const int urlColumn = model_->fieldIndex("url");
-
-    if (titleColumn < 0 || categoryColumn < 0 || urlColumn < 0) {
-        showError("Schema Error", "The links table is missing required columns.");
-        return;
-    }
-
     LinkDialog dialog(this);
     if (row >= 0) {
         dialog.setMode(LinkDialog::Mode::Edit);
-        const auto record = model_->record(row);
-        dialog.setLink({
-            record.value("title").toString(),
-            record.value("category").toString(),
-            record.value("url").toString()
-        });
+        dialog.setLink(model_->link(row));
     } else {
         dialog.setMode(LinkDialog::Mode::Create);
     }
@@ -411,25 +1050,62 @@ void MainWindow::openLinkDialog(int row)
     }
 
     const auto link = dialog.link();
+    const qint64 id = row >= 0 ? model_->linkId(row) : -1;
+    if (row >= 0 && LinkUrls::canonical(model_->link(row).url) == LinkUrls::canonical(link.url)) {
+        applyLinkEdit(row, id, link);
+        return;
+    }
 
-    if (row < 0) {
-        QSqlRecord record = model_->record();
-        record.setValue("title", link.title);
-        record.setValue("category", link.category);
-        record.setValue("url", link.url);
-
-        if (!model_->insertRecord(-1, record)) {
-            showError("Database Error", model_->lastError().text());
+    Futures::whenFinished(database_->findByUrl(link.url), this, [this, row, id, link](const LinkQueryResult &result) {
+        if (!model_) {
+            return;
+        }
+        if (!result.ok) {
+            showError("Duplicate Check Failed", result.errorMessage);
             return;
         }
 
+        QStringList titles;
+        for (const auto &record : result.records) {
+            if (record.id != id) {
+                titles.append(QString("%1 (%2)").arg(record.link.title, record.link.category));
+            }
+        }
+        if (!titles.isEmpty()) {
+            const auto response = QMessageBox::question(
+                this, "Duplicate Link",
+                QString("This URL is already saved as:\n\n%1\n\nSave it anyway?").arg(titles.join('\n')));
+            if (response != QMessageBox::Yes) {
+                return;
+            }
+        }
+        applyLinkEdit(row, id, link);
+    });
+}
+
+void MainWindow::applyLinkEdit(int row, qint64 id, const LinkItem &link)
+{
+    // The duplicate check and its prompt can outlast the click on Save.
+    // Rows edited now would be marked committed by that save without being
+    // written, so the edit waits for it.
+    if (model_->isSaving()) {
+        deferredEdits_.append({row, id, link});
+        statusBar()->showMessage("The edit is applied once the save finishes.");
+        return;
+    }
+
+    if (row < 0) {
+        model_->appendLink(link);
         markPendingChanges("Link added. Click Save to commit.");
         return;
     }
 
-    model_->setData(model_->index(row, titleColumn), link.title);
-    model_->setData(model_->index(row, categoryColumn), link.category);
-    model_->setData(model_->index(row, urlColumn), link.url);
+    // Rows can move while the duplicate check runs.
+    if (row >= model_->rowCount() || model_->linkId(row) != id) {
+        statusBar()->showMessage("The link changed while it was being edited; edit it again.", 5000);
+        return;
+    }
+    model_->updateLink(row, link);
     markPendingChanges();
 }
 
@@ -443,8 +1119,9 @@ void MainWindow::showError(const QString &title, const QString &message)
     QMessageBox::critical(this, title, message);
 }
 
-void MainWindow::openUrl(const QString &urlText)
+void MainWindow::openUrl(qint64 id, const QString &urlText)
 {
+    const Tracing::Span span("MainWindow::openUrl");
     const auto url = QUrl::fromUserInput(urlText);
     if (!url.isValid()) {
         showError("Invalid URL", "The selected link has an invalid URL.");
@@ -453,5 +1130,80 @@ void MainWindow::openUrl(const QString &urlText)
 
     if (!QDesktopServices::openUrl(url)) {
         showError("Open Failed", "Unable to open the link in the default browser.");
+        return;
+    }
+    recordVisit(id);
+}
+
+void MainWindow::recordVisit(qint64 id)
+{
+    if (id < 0) {
+        // Not saved yet, so there is no row to credit.
+        return;
+    }
+    if (!usageLog_.record(id, QDateTime::currentSecsSinceEpoch())) {
+        qWarning("Usage log full; the oldest unsaved link open was dropped.");
+    }
+    if (usageLog_.size() * 4 >= usageLog_.capacity() * 3) {
+        flushUsage();
+        return;
+    }
+
+    if (!usageFlushTimer_) {
+        usageFlushTimer_ = new QTimer(this);
+        usageFlushTimer_->setSingleShot(true);
+        usageFlushTimer_->setInterval(kUsageFlushDelayMs);
+        connect(usageFlushTimer_, &QTimer::timeout, this, &MainWindow::flushUsage);
+    }
+    if (!usageFlushTimer_->isActive()) {
+        usageFlushTimer_->start();
+    }
+}
+
+void MainWindow::flushUsage()
+{
+    if (usageFlushTimer_) {
+        usageFlushTimer_->stop();
+    }
+    // Opens made before the database is ready stay buffered until the next open.
+    if (!databaseReady_ || !database_ || usageLog_.isEmpty()) {
+        return;
+    }
+
+    Futures::whenFinished(database_->recordVisits(usageLog_.drain()), this, [this](const LinkFrecencyResult &result) {
+        if (!result.ok) {
+            qWarning("Unable to save link usage: %s", qPrintable(result.errorMessage));
+            return;
+        }
+        bool changed = false;
+        for (const auto &entry : result.entries) {
+            changed = frecency_.update(entry) || changed;
+        }
+        if (changed && trayController_) {
+            trayController_->setTopLinks(frecency_.top());
+        }
+    });
+}
+
+void MainWindow::loadFrecency()
+{
+    Futures::whenFinished(database_->loadFrecency(), this, [this](const LinkFrecencyResult &result) {
+        if (!result.ok) {
+            qWarning("Unable to load link usage: %s", qPrintable(result.errorMessage));
+            return;
+        }
+        frecency_.reset(result.entries);
+        if (trayController_) {
+            trayController_->setTopLinks(frecency_.top());
+        }
+        // Opens made while the database was opening.
+        flushUsage();
+    });
+}
+
+void MainWindow::applyFrecencyChanges(const LinkChangeSet &changes)
+{
+    if (frecency_.apply(changes) && trayController_) {
+        trayController_->setTopLinks(frecency_.top());
     }
 }
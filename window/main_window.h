@@ -1,14 +1,28 @@
 #pragma once
 
+#include <QList>
 #include <QMainWindow>
 #include <QSystemTrayIcon>
 
+#include "../data/frecency.h"
+#include "../data/fuzzy_index.h"
+#include "../data/usage_log.h"
+#include "../single_instance.h"
+
 class QAction;
+class QLineEdit;
 class QMenu;
 class QPushButton;
-class QSqlTableModel;
 class QTableView;
+class QTimer;
 class QCloseEvent;
+class QFileSystemWatcher;
+class AsyncDatabase;
+class LinkHealthChecker;
+class LinkTableProxy;
+class LinksModel;
+class QuickSearchDialog;
+class TrayMenuController;
 
 namespace Ui {
 class MainWindow;
@@ -21,42 +35,125 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // Runs commands forwarded from other launches; they wait until the
+    // database is open.
+    void handleInstanceCommands(const QList<InstanceCommand> &commands);
+
 protected:
     void closeEvent(QCloseEvent *event) override;
 
 private:
+    void ensureUi();
+    void showWindow();
+    void disableDatabaseControls();
     void setupUi();
     void setupModel();
     void setupTray();
+    void restoreTraySnapshot();
+    void saveTraySnapshot();
     void refreshTrayMenu();
+    void startChangeTracking();
+    void watchDatabaseFiles();
+    void pollExternalChanges();
+    void ensureFuzzyIndex();
+    void rebuildFuzzyIndex(const QList<LinkRecord> &records);
+    void applyFuzzyChanges(const LinkChangeSet &changes);
     void updateButtonStates();
 
     void handleEdit();
     void handleAdd();
     void handleDelete();
     void handleSave();
+    void handleSaveFinished(bool ok, const QString &errorMessage);
+    void handleImport();
+    void startImport(const QString &path);
+    void commitInstanceAdds();
+    void handleInstanceAddsFailed(const QList<LinkItem> &links, const QString &errorMessage);
+    void openBestMatch(const QString &query);
+    void handleExport();
+    void handleBackup();
+    void handleCheckLinks();
+    void handleHealthResults(const QList<LinkHealth> &results);
+    void loadLinkHealth();
+    void handleStorageSettings();
+    void restartMaintenanceTimer();
     void handleAddFromTray();
+    void handleSearchTextChanged(const QString &text);
+    void showQuickSearch();
+    void runQuickSearch(const QString &query);
 
     void openLinkDialog(int row);
+    void applyLinkEdit(int row, qint64 id, const LinkItem &link);
     int selectedRow() const;
     void markPendingChanges(const QString &message = "Changes pending. Click Save to commit.");
     void showError(const QString &title, const QString &message);
-    void openUrl(const QString &urlText);
+    // id is the link being opened, credited with the visit.
+    void openUrl(qint64 id, const QString &urlText);
+    void recordVisit(qint64 id);
+    void flushUsage();
+    void loadFrecency();
+    void applyFrecencyChanges(const LinkChangeSet &changes);
 
     Ui::MainWindow *ui_ = nullptr;
+    QLineEdit *searchLineEdit_ = nullptr;
     QTableView *tableView_ = nullptr;
     QPushButton *addButton_ = nullptr;
     QPushButton *editButton_ = nullptr;
     QPushButton *deleteButton_ = nullptr;
+    QPushButton *importButton_ = nullptr;
+    QPushButton *exportButton_ = nullptr;
+    QPushButton *backupButton_ = nullptr;
+    QPushButton *checkLinksButton_ = nullptr;
+    QPushButton *settingsButton_ = nullptr;
     QPushButton *saveButton_ = nullptr;
 
     QSystemTrayIcon *trayIcon_ = nullptr;
     QMenu *trayMenu_ = nullptr;
+    QAction *quickSearchAction_ = nullptr;
     QAction *toggleWindowAction_ = nullptr;
     QAction *addLinkAction_ = nullptr;
     QAction *quitAction_ = nullptr;
+    TrayMenuController *trayController_ = nullptr;
+    QuickSearchDialog *quickSearchDialog_ = nullptr;
+
+    AsyncDatabase *database_ = nullptr;
+    QTimer *maintenanceTimer_ = nullptr;
+    QTimer *changePollTimer_ = nullptr;
+    QFileSystemWatcher *databaseWatcher_ = nullptr;
+    LinkHealthChecker *healthChecker_ = nullptr;
+    // Newest change log sequence already reflected in the views; -1 until known.
+    qint64 changeSequence_ = -1;
+    bool pollingChanges_ = false;
 
-    QSqlTableModel *model_ = nullptr;
+    // Edits accepted while a save was running; applied once it finishes.
+    struct DeferredEdit {
+        int row;
+        qint64 id;
+        LinkItem link;
+    };
+    QList<DeferredEdit> deferredEdits_;
+
+    QList<InstanceCommand> pendingInstanceCommands_;
+    QList<LinkItem> pendingAdds_;
+    bool committingAdds_ = false;
+    // Failed commits of pendingAdds_ in a row; see handleInstanceAddsFailed().
+    int failedAddAttempts_ = 0;
+    LinksModel *model_ = nullptr;
+    LinkTableProxy *proxy_ = nullptr;
+    bool databaseReady_ = false;
+    bool databaseFailed_ = false;
     bool trayAvailable_ = false;
     bool trayNoticeShown_ = false;
+    QByteArray traySnapshotStamp_;
+    bool traySnapshotFresh_ = false;
+
+    // Opens wait here and are written in batches; see flushUsage().
+    UsageLog usageLog_;
+    QTimer *usageFlushTimer_ = nullptr;
+    FrecencyRanking frecency_;
+
+    FuzzyIndex fuzzyIndex_;
+    bool fuzzyIndexRequested_ = false;
+    bool fuzzyIndexReady_ = false;
+    QList<LinkChangeSet> pendingFuzzyChanges_;
 };
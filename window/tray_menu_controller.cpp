@@ -0,0 +1,320 @@
+#include "tray_menu_controller.h"
+
+#include "../data/tray_snapshot.h"
+
+#include <QAction>
+#include <QApplication>
+#include <QMenu>
+#include <QStyle>
+#include <QVariant>
+
+TrayMenuController::TrayMenuController(QMenu *menu, QObject *parent)
+    : QObject(parent)
+    , menu_(menu)
+{
+}
+
+void TrayMenuController::setFooterAnchor(QAction *anchor)
+{
+    footerAnchor_ = anchor;
+
+    delete footerSeparator_;
+    footerSeparator_ = new QAction(menu_);
+    footerSeparator_->setSeparator(true);
+    menu_->insertAction(footerAnchor_, footerSeparator_);
+    updatePlaceholder();
+}
+
+void TrayMenuController::setPlaceholderText(const QString &text)
+{
+    placeholderText_ = text;
+    if (placeholder_) {
+        placeholder_->setText(text);
+    }
+}
+
+void TrayMenuController::restore(const std::shared_ptr<const TraySnapshot> &snapshot)
+{
+    clear();
+    setPlaceholderText("No links yet");
+
+    snapshot_ = snapshot;
+    for (int group = 0; group < snapshot_->groupCount(); ++group) {
+        const auto key = snapshot_->groupKey(group);
+        snapshotGroups_.insert(key, group);
+        ensureSection(key);
+    }
+
+    updatePlaceholder();
+}
+
+std::shared_ptr<const TraySnapshot> TrayMenuController::snapshot() const
+{
+    return snapshot_;
+}
+
+void TrayMenuController::reset(const QList<LinkRecord> &records)
+{
+    LinkGroups groups;
+    groups.reset(records);
+    setGroups(groups);
+}
+
+void TrayMenuController::setGroups(const LinkGroups &groups)
+{
+    setPlaceholderText("No links yet");
+    snapshot_.reset();
+    snapshotGroups_.clear();
+    groups_ = groups;
+    groupsLoaded_ = true;
+
+    // Keep the sections that survive, so an open menu does not flicker when
+    // snapshot data is replaced by the same groups from the database.
+    const auto keys = sections_.keys();
+    for (const auto &key : keys) {
+        if (!groups_.groups().contains(key)) {
+            removeSection(key);
+            continue;
+        }
+        auto &section = sections_[key];
+        section.menu->setTitle(groups_.groups().value(key).category);
+        invalidateSection(section);
+    }
+    for (auto it = groups_.groups().cbegin(); it != groups_.groups().cend(); ++it) {
+        ensureSection(it.key());
+    }
+
+    const auto pending = pendingChanges_;
+    pendingChanges_.clear();
+    for (const auto &changes : pending) {
+        apply(changes);
+    }
+    updatePlaceholder();
+}
+
+void TrayMenuController::apply(const LinkChangeSet &changes)
+{
+    if (!groupsLoaded_) {
+        pendingChanges_.append(changes);
+        return;
+    }
+
+    const auto changed = groups_.apply(changes);
+    for (const auto &key : changed) {
+        if (!groups_.groups().contains(key)) {
+            removeSection(key);
+            continue;
+        }
+        invalidateSection(ensureSection(key));
+    }
+    updatePlaceholder();
+}
+
+void TrayMenuController::setTopLinks(const QList<LinkRecord> &links)
+{
+    topLinks_ = links;
+    rebuildTopLinks();
+}
+
+void TrayMenuController::setLinkHealth(const QList<LinkHealth> &results)
+{
+    bool changed = false;
+    for (const auto &health : results) {
+        if (health.isDead()) {
+            const auto description = health.describe();
+            const auto existing = deadLinks_.constFind(health.linkId);
+            changed = existing == deadLinks_.cend() || *existing != description || changed;
+            deadLinks_.insert(health.linkId, description);
+        } else {
+            changed = deadLinks_.remove(health.linkId) > 0 || changed;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+
+    // Sections are rebuilt the next time they open.
+    for (auto &section : sections_) {
+        invalidateSection(section);
+    }
+    rebuildTopLinks();
+}
+
+bool TrayMenuController::hasGroups() const
+{
+    return groupsLoaded_;
+}
+
+const LinkGroups &TrayMenuController::groups() const
+{
+    return groups_;
+}
+
+void TrayMenuController::clear()
+{
+    const auto keys = sections_.keys();
+    for (const auto &key : keys) {
+        removeSection(key);
+    }
+    groups_.clear();
+    groupsLoaded_ = false;
+    snapshot_.reset();
+    snapshotGroups_.clear();
+}
+
+QString TrayMenuController::sectionTitle(const QByteArray &key) const
+{
+    if (snapshot_) {
+        return snapshot_->category(snapshotGroups_.value(key, -1));
+    }
+    return groups_.groups().value(key).category;
+}
+
+TrayMenuController::Section &TrayMenuController::ensureSection(const QByteArray &key)
+{
+    const auto existing = sections_.find(key);
+    if (existing != sections_.end()) {
+        return *existing;
+    }
+
+    QAction *before = actionAfterSection(key);
+
+    Section section;
+    section.menu = new QMenu(sectionTitle(key), menu_);
+    section.menu->setToolTipsVisible(true);
+    connect(section.menu, &QMenu::aboutToShow, this, [this, key]() { populateSection(key); });
+    connect(section.menu, &QMenu::triggered, this, [this](QAction *action) {
+        const auto link = action->data().toList();
+        emit linkTriggered(link.value(0).toLongLong(), link.value(1).toString());
+    });
+    menu_->insertMenu(before, section.menu);
+
+    return *sections_.insert(key, section);
+}
+
+void TrayMenuController::removeSection(const QByteArray &key)
+{
+    const auto it = sections_.find(key);
+    if (it == sections_.end()) {
+        return;
+    }
+
+    delete it->menu;
+    sections_.erase(it);
+}
+
+void TrayMenuController::populateSection(const QByteArray &key)
+{
+    const auto it = sections_.find(key);
+    if (snapshot_ && it != sections_.end() && !it->populated) {
+        populateFromSnapshot(*it, snapshotGroups_.value(key, -1));
+        return;
+    }
+    const auto group = groups_.groups().constFind(key);
+    if (it == sections_.end() || it->populated || group == groups_.groups().cend()) {
+        return;
+    }
+
+    QList<QAction *> actions;
+    actions.reserve(group->entries.size());
+    for (const auto &entry : group->entries) {
+        actions.append(createLinkAction(entry.id, groups_.title(entry), groups_.url(entry), it->menu));
+    }
+    it->menu->addActions(actions);
+    it->populated = true;
+}
+
+void TrayMenuController::populateFromSnapshot(Section &section, int group)
+{
+    const int count = snapshot_->entryCount(group);
+    QList<QAction *> actions;
+    actions.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const auto entry = snapshot_->entry(group, i);
+        actions.append(createLinkAction(entry.id, QString::fromUtf8(entry.title), QString::fromUtf8(entry.url),
+                                        section.menu));
+    }
+    section.menu->addActions(actions);
+    section.populated = true;
+}
+
+void TrayMenuController::invalidateSection(Section &section)
+{
+    if (!section.populated) {
+        return;
+    }
+
+    // QMenu::clear() deletes the actions the menu owns.
+    section.menu->clear();
+    section.populated = false;
+}
+
+QAction *TrayMenuController::createLinkAction(qint64 id, const QString &title, const QString &url,
+                                              QMenu *menu) const
+{
+    auto *action = new QAction(title, menu);
+    // Id and URL, read back by the section menus' triggered().
+    action->setData(QVariantList{id, url});
+    const auto dead = deadLinks_.constFind(id);
+    if (dead != deadLinks_.cend()) {
+        action->setIcon(QApplication::style()->standardIcon(QStyle::SP_MessageBoxWarning));
+        action->setToolTip(QString("Dead link: %1").arg(*dead));
+    }
+    return action;
+}
+
+void TrayMenuController::rebuildTopLinks()
+{
+    qDeleteAll(topActions_);
+    topActions_.clear();
+    if (topLinks_.isEmpty()) {
+        delete topSection_;
+        delete topEnd_;
+        topSection_ = nullptr;
+        topEnd_ = nullptr;
+        return;
+    }
+
+    if (!topSection_) {
+        QAction *first = menu_->actions().value(0);
+        topSection_ = menu_->insertSection(first, "Top Links");
+        topEnd_ = new QAction(menu_);
+        topEnd_->setSeparator(true);
+        menu_->insertAction(first, topEnd_);
+    }
+
+    for (const auto &record : std::as_const(topLinks_)) {
+        auto *action = createLinkAction(record.id, record.link.title, record.link.url, menu_);
+        // Actions of the root menu are not covered by the sections' triggered().
+        connect(action, &QAction::triggered, this,
+                [this, id = record.id, url = record.link.url]() { emit linkTriggered(id, url); });
+        menu_->insertAction(topEnd_, action);
+        topActions_.append(action);
+    }
+}
+
+QAction *TrayMenuController::actionAfterSection(const QByteArray &key) const
+{
+    const auto next = sections_.upperBound(key);
+    if (next != sections_.cend()) {
+        return next->menu->menuAction();
+    }
+    return placeholder_ ? placeholder_ : footerSeparator_;
+}
+
+void TrayMenuController::updatePlaceholder()
+{
+    if (!sections_.isEmpty()) {
+        delete placeholder_;
+        placeholder_ = nullptr;
+        return;
+    }
+
+    if (placeholder_) {
+        return;
+    }
+
+    placeholder_ = new QAction(placeholderText_, menu_);
+    placeholder_->setEnabled(false);
+    menu_->insertAction(footerSeparator_, placeholder_);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QString>
+
+#include "../data/link_groups.h"
+#include "../models/link_health.h"
+
+class QAction;
+class QMenu;
+class TraySnapshot;
+
+// Keeps the link section of the tray menu in sync with the links table.
+// The root menu holds one submenu per LinkGroups category; a submenu's
+// actions are only built the first time it is opened and are dropped again
+// when its links change. Until the real groups arrive, sections can be
+// served straight from a memory-mapped TraySnapshot.
+class TrayMenuController : public QObject {
+    Q_OBJECT
+
+public:
+    explicit TrayMenuController(QMenu *menu, QObject *parent = nullptr);
+
+    // Category submenus are inserted above this action (the first footer entry).
+    void setFooterAnchor(QAction *anchor);
+
+    // Shown in place of the category list while there is nothing to list.
+    void setPlaceholderText(const QString &text);
+
+    // Shows the snapshot's sections until reset() or setGroups() is called.
+    void restore(const std::shared_ptr<const TraySnapshot> &snapshot);
+    std::shared_ptr<const TraySnapshot> snapshot() const;
+
+    void reset(const QList<LinkRecord> &records);
+    void setGroups(const LinkGroups &groups);
+    // Changes that arrive before the groups are loaded are applied after.
+    void apply(const LinkChangeSet &changes);
+
+    // The "Top Links" section at the head of the menu, best first; an empty
+    // list removes it.
+    void setTopLinks(const QList<LinkRecord> &links);
+
+    // Marks dead links with a warning icon; see LinkHealth::isDead().
+    void setLinkHealth(const QList<LinkHealth> &results);
+
+    bool hasGroups() const;
+    const LinkGroups &groups() const;
+
+signals:
+    void linkTriggered(qint64 id, const QString &url);
+
+private:
+    struct Section {
+        QMenu *menu = nullptr;
+        bool populated = false;
+    };
+
+    void clear();
+    QString sectionTitle(const QByteArray &key) const;
+    void populateFromSnapshot(Section &section, int group);
+    // Sections are keyed like LinkGroups::groups(), by category sort key.
+    Section &ensureSection(const QByteArray &key);
+    void removeSection(const QByteArray &key);
+    void populateSection(const QByteArray &key);
+    void invalidateSection(Section &section);
+    QAction *createLinkAction(qint64 id, const QString &title, const QString &url, QMenu *menu) const;
+    void rebuildTopLinks();
+    QAction *actionAfterSection(const QByteArray &key) const;
+    void updatePlaceholder();
+
+    QMenu *menu_ = nullptr;
+    QAction *footerAnchor_ = nullptr;
+    QAction *footerSeparator_ = nullptr;
+    QAction *placeholder_ = nullptr;
+    QString placeholderText_ = "Loading links...";
+    LinkGroups groups_;
+    bool groupsLoaded_ = false;
+    QList<LinkChangeSet> pendingChanges_;
+    std::shared_ptr<const TraySnapshot> snapshot_;
+    // Snapshot group index by category sort key.
+    QHash<QByteArray, int> snapshotGroups_;
+    QMap<QByteArray, Section> sections_;
+    QList<LinkRecord> topLinks_;
+    QAction *topSection_ = nullptr;
+    QAction *topEnd_ = nullptr;
+    QList<QAction *> topActions_;
+    // LinkHealth::describe() of dead links, by id.
+    QHash<qint64, QString> deadLinks_;
+};